@@ -8,6 +8,18 @@
 
 namespace tinywebserver {
 
+namespace {
+
+// 与 Statement 一一对应的 SQL
+constexpr const char* kStatementSql[] = {
+    "INSERT INTO user(username, passwd) VALUES(?, ?)",
+};
+static_assert(sizeof(kStatementSql) / sizeof(kStatementSql[0]) ==
+                  static_cast<size_t>(Statement::kCount),
+              "kStatementSql must cover every Statement");
+
+}  // namespace
+
 // ConnectionPool 实现
 
 ConnectionPool::ConnectionPool()
@@ -58,6 +70,7 @@ void ConnectionPool::Init(const std::string& url, const std::string& user,
     }
 
     conn_list_.push_back(conn);
+    statements_[conn].fill(nullptr);
     ++free_conn_count_;
   }
 
@@ -125,6 +138,12 @@ void ConnectionPool::DestroyPool() {
     if (!conn_list_.empty()) {
       for (auto it = conn_list_.begin(); it != conn_list_.end(); ++it) {
         MYSQL* conn = *it;
+        for (MYSQL_STMT*& stmt : statements_[conn]) {
+          if (stmt != nullptr) {
+            mysql_stmt_close(stmt);
+            stmt = nullptr;
+          }
+        }
         mysql_close(conn);
       }
 
@@ -142,6 +161,45 @@ void ConnectionPool::DestroyPool() {
   }
 }
 
+MYSQL_STMT* ConnectionPool::GetStatement(MYSQL* conn, Statement statement) {
+  auto it = statements_.find(conn);
+  if (it == statements_.end()) {
+    return nullptr;
+  }
+  size_t index = static_cast<size_t>(statement);
+  MYSQL_STMT*& stmt = it->second[index];
+  if (stmt != nullptr) {
+    return stmt;
+  }
+
+  // 首次使用：在该连接上 prepare 并缓存
+  MYSQL_STMT* prepared = mysql_stmt_init(conn);
+  if (prepared == nullptr) {
+    LOG_ERROR("mysql_stmt_init error: %s", mysql_error(conn));
+    return nullptr;
+  }
+  const char* sql = kStatementSql[index];
+  if (mysql_stmt_prepare(prepared, sql, std::strlen(sql)) != 0) {
+    LOG_ERROR("mysql_stmt_prepare error: %s", mysql_stmt_error(prepared));
+    mysql_stmt_close(prepared);
+    return nullptr;
+  }
+  stmt = prepared;
+  return stmt;
+}
+
+void ConnectionPool::ResetStatement(MYSQL* conn, Statement statement) {
+  auto it = statements_.find(conn);
+  if (it == statements_.end()) {
+    return;
+  }
+  MYSQL_STMT*& stmt = it->second[static_cast<size_t>(statement)];
+  if (stmt != nullptr) {
+    mysql_stmt_close(stmt);
+    stmt = nullptr;
+  }
+}
+
 // ConnectionRAII 实现
 
 ConnectionRAII::ConnectionRAII(MYSQL** conn, ConnectionPool* pool)
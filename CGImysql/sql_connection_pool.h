@@ -7,17 +7,26 @@
 
 #include <mysql/mysql.h>
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "../log/log.h"
 
 namespace tinywebserver {
 
+// 每个池化连接上缓存的预处理语句
+enum class Statement {
+  kInsertUser = 0,     // INSERT INTO user(username, passwd) VALUES(?, ?)
+  kCount
+};
+
 // 使用单例模式的 MySQL 连接池。
 // 提供线程安全的数据库连接访问。
 class ConnectionPool {
@@ -53,6 +62,19 @@ class ConnectionPool {
   // @return 如果成功返回 true，如果 conn 为 nullptr 返回 false
   bool ReleaseConnection(MYSQL* conn);
 
+  // 获取连接上缓存的预处理语句，首次使用时在该连接上 prepare 一次，
+  // 之后的请求直接绑定参数执行，服务端不再重复解析 SQL。
+  // 调用方必须持有该连接（经 GetConnection 取得）。
+  // @param conn 连接池中的连接
+  // @param statement 语句
+  // @return 语句句柄，prepare 失败时返回 nullptr
+  MYSQL_STMT* GetStatement(MYSQL* conn, Statement statement);
+
+  // 丢弃执行失败的语句，下次使用时重新 prepare。
+  // @param conn 连接池中的连接
+  // @param statement 语句
+  void ResetStatement(MYSQL* conn, Statement statement);
+
   // 获取空闲连接数量。
   int GetFreeConnCount() const { return free_conn_count_; }
 
@@ -74,6 +96,12 @@ class ConnectionPool {
   std::condition_variable cond_;      // 阻塞用的条件变量
   std::list<MYSQL*> conn_list_;       // 连接列表
 
+  using StatementCache =
+      std::array<MYSQL_STMT*, static_cast<size_t>(Statement::kCount)>;
+  // 每个连接的预处理语句。键在 Init 中建立后不再变化，
+  // 值只由持有该连接的线程读写，因此访问无需加锁
+  std::unordered_map<MYSQL*, StatementCache> statements_;
+
   std::atomic<bool> is_destroyed_;  // 销毁标志
 
  public:
@@ -0,0 +1,245 @@
+// Copyright 2025 TinyWebServer
+// 内存用户表的实现
+
+#include "user_store.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace tinywebserver {
+
+namespace {
+
+// 绑定一个字符串参数或结果缓冲区
+void BindString(MYSQL_BIND* bind, char* buffer, unsigned long capacity,
+                unsigned long* length) {
+  bind->buffer_type = MYSQL_TYPE_STRING;
+  bind->buffer = buffer;
+  bind->buffer_length = capacity;
+  bind->length = length;
+}
+
+// 用连接上缓存的预处理语句插入一个用户
+bool InsertUser(ConnectionPool* pool, const std::string& name,
+                const std::string& password) {
+  MYSQL* mysql = nullptr;
+  ConnectionRAII mysql_conn(&mysql, pool);
+  if (mysql == nullptr) {
+    return false;
+  }
+  MYSQL_STMT* stmt = pool->GetStatement(mysql, Statement::kInsertUser);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  MYSQL_BIND params[2];
+  std::memset(params, 0, sizeof(params));
+  unsigned long lengths[2] = {name.size(), password.size()};
+  BindString(&params[0], const_cast<char*>(name.data()), lengths[0],
+             &lengths[0]);
+  BindString(&params[1], const_cast<char*>(password.data()), lengths[1],
+             &lengths[1]);
+  if (mysql_stmt_bind_param(stmt, params) || mysql_stmt_execute(stmt)) {
+    LOG_ERROR("INSERT error: %s", mysql_stmt_error(stmt));
+    pool->ResetStatement(mysql, Statement::kInsertUser);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+UserStore::UserStore() {
+  for (Shard& shard : shards_) {
+    shard.table = std::make_shared<const Table>();
+  }
+}
+
+UserStore::~UserStore() { StopRefresh(); }
+
+UserStore* UserStore::GetInstance() {
+  static UserStore store;
+  return &store;
+}
+
+const UserStore::Shard& UserStore::ShardFor(const std::string& name) const {
+  return shards_[std::hash<std::string>()(name) % kShardCount];
+}
+
+UserStore::Shard& UserStore::ShardFor(const std::string& name) {
+  return shards_[std::hash<std::string>()(name) % kShardCount];
+}
+
+std::shared_ptr<const UserStore::Table> UserStore::Snapshot(
+    const Shard& shard) {
+  return std::atomic_load_explicit(&shard.table, std::memory_order_acquire);
+}
+
+bool UserStore::Login(const std::string& name, const std::string& password) {
+  // 不因未知用户名查库：任意用户名都能触发的查询会占住工作线程和连接池
+  return Verify(name, password);
+}
+
+bool UserStore::Register(const std::string& name,
+                         const std::string& password) {
+  // 先占用用户名，并发注册同名用户只有一个能继续写库
+  if (!Insert(name, password)) {
+    return false;
+  }
+  if (!InsertUser(ConnectionPool::GetInstance(), name, password)) {
+    Erase(name);
+    return false;
+  }
+  return true;
+}
+
+bool UserStore::Verify(const std::string& name,
+                       const std::string& password) const {
+  std::shared_ptr<const Table> table = Snapshot(ShardFor(name));
+  auto it = table->find(name);
+  return it != table->end() && it->second == password;
+}
+
+bool UserStore::Contains(const std::string& name) const {
+  std::shared_ptr<const Table> table = Snapshot(ShardFor(name));
+  return table->count(name) != 0;
+}
+
+bool UserStore::Insert(const std::string& name, const std::string& password) {
+  Shard& shard = ShardFor(name);
+  std::lock_guard<std::mutex> lock(shard.write_mutex);
+  std::shared_ptr<const Table> current = Snapshot(shard);
+  if (current->count(name) != 0) {
+    return false;
+  }
+  // 复制当前快照，修改副本后再发布，正在读旧快照的线程不受影响
+  auto next = std::make_shared<Table>(*current);
+  next->emplace(name, password);
+  std::atomic_store_explicit(&shard.table,
+                             std::shared_ptr<const Table>(std::move(next)),
+                             std::memory_order_release);
+  return true;
+}
+
+void UserStore::Erase(const std::string& name) {
+  Shard& shard = ShardFor(name);
+  std::lock_guard<std::mutex> lock(shard.write_mutex);
+  std::shared_ptr<const Table> current = Snapshot(shard);
+  if (current->count(name) == 0) {
+    return;
+  }
+  auto next = std::make_shared<Table>(*current);
+  next->erase(name);
+  std::atomic_store_explicit(&shard.table,
+                             std::shared_ptr<const Table>(std::move(next)),
+                             std::memory_order_release);
+}
+
+size_t UserStore::size() const {
+  size_t total = 0;
+  for (const Shard& shard : shards_) {
+    total += Snapshot(shard)->size();
+  }
+  return total;
+}
+
+bool UserStore::Refresh(ConnectionPool* conn_pool) {
+  // 先按分片收集 user 表中的全部行，查询期间不持有任何分片的锁
+  std::array<std::vector<std::pair<std::string, std::string>>, kShardCount>
+      rows;
+  {
+    MYSQL* mysql = nullptr;
+    ConnectionRAII mysqlcon(&mysql, conn_pool);
+    if (mysql == nullptr) {
+      LOG_ERROR("%s", "MySQL connection retrieval failed");
+      return false;
+    }
+
+    // 在 user 表中检索 username，passwd 数据
+    if (mysql_query(mysql, "SELECT username,passwd FROM user")) {
+      LOG_ERROR("SELECT error: %s", mysql_error(mysql));
+      return false;
+    }
+
+    // 从表中检索完整的结果集
+    MYSQL_RES* result = mysql_store_result(mysql);
+    if (result == nullptr) {
+      if (mysql_field_count(mysql) != 0) {
+        LOG_ERROR("mysql_store_result error: %s", mysql_error(mysql));
+        return false;
+      }
+      return true;
+    }
+    while (MYSQL_ROW row = mysql_fetch_row(result)) {
+      if (row[0] == nullptr || row[1] == nullptr) {
+        continue;
+      }
+      std::string name(row[0]);
+      size_t index = std::hash<std::string>()(name) % kShardCount;
+      rows[index].emplace_back(std::move(name), row[1]);
+    }
+    mysql_free_result(result);
+  }
+
+  // 逐个分片合并，没有变化的分片不复制
+  size_t changed = 0;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.write_mutex);
+    std::shared_ptr<const Table> current = Snapshot(shard);
+    std::shared_ptr<Table> next;
+    for (auto& [name, password] : rows[i]) {
+      auto it = current->find(name);
+      if (it != current->end() && it->second == password) {
+        continue;
+      }
+      if (!next) {
+        next = std::make_shared<Table>(*current);
+      }
+      (*next)[std::move(name)] = std::move(password);
+      ++changed;
+    }
+    if (next) {
+      std::atomic_store_explicit(&shard.table,
+                                 std::shared_ptr<const Table>(std::move(next)),
+                                 std::memory_order_release);
+    }
+  }
+  if (changed > 0) {
+    LOG_INFO("User store refreshed: %zu changed, %zu total", changed, size());
+  }
+  return true;
+}
+
+void UserStore::StartRefresh(ConnectionPool* conn_pool, int interval_s) {
+  if (interval_s <= 0 || refresh_thread_.joinable()) {
+    return;
+  }
+  refresh_stop_ = false;
+  refresh_thread_ = std::thread([this, conn_pool, interval_s]() {
+    std::unique_lock<std::mutex> lock(refresh_mutex_);
+    while (!refresh_cond_.wait_for(lock, std::chrono::seconds(interval_s),
+                                   [this] { return refresh_stop_; })) {
+      lock.unlock();
+      Refresh(conn_pool);
+      lock.lock();
+    }
+  });
+}
+
+void UserStore::StopRefresh() {
+  if (!refresh_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(refresh_mutex_);
+    refresh_stop_ = true;
+  }
+  refresh_cond_.notify_all();
+  refresh_thread_.join();
+}
+
+}  // namespace tinywebserver
@@ -0,0 +1,117 @@
+// Copyright 2025 TinyWebServer
+// 登录/注册使用的内存用户表：分片、读多写少、定期从 MySQL 刷新
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_CGIMYSQL_USER_STORE_H_
+#define TINYWEBSERVER_CGIMYSQL_USER_STORE_H_
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "sql_connection_pool.h"
+
+namespace tinywebserver {
+
+// 用户名到密码的并发哈希表。
+// 按用户名哈希分为 kShardCount 个分片，每个分片发布一份不可变的快照：
+// 读者原子地取得快照后无锁查找；写者在分片的互斥锁内复制快照、修改副本
+// 并原子地替换（RCU 风格），旧快照在最后一个读者放手后释放。
+// 注册很少而登录频繁，写入只复制一个分片，查找始终为 O(1) 且不会被写入阻塞。
+class UserStore {
+ public:
+  // 获取 UserStore 的单例实例。
+  static UserStore* GetInstance();
+
+  // 禁用拷贝和移动操作
+  UserStore(const UserStore&) = delete;
+  UserStore& operator=(const UserStore&) = delete;
+  UserStore(UserStore&&) = delete;
+  UserStore& operator=(UserStore&&) = delete;
+
+  // 处理登录：只查内存表，不访问数据库。其他节点注册的用户在下一次
+  // 后台刷新（StartRefresh）后才能在本节点登录。
+  // @param name 用户名
+  // @param password 密码
+  // @return 凭据有效时返回 true
+  bool Login(const std::string& name, const std::string& password);
+
+  // 处理注册：先占用用户名，再用预处理语句写入 user 表，写库失败时撤销占用。
+  // @param name 用户名
+  // @param password 密码
+  // @return 注册成功返回 true，用户名已存在或写库失败返回 false
+  bool Register(const std::string& name, const std::string& password);
+
+  // 只在内存表中校验登录凭据。
+  // @param name 用户名
+  // @param password 密码
+  // @return 用户存在且密码一致时返回 true
+  bool Verify(const std::string& name, const std::string& password) const;
+
+  // @return 用户名是否已存在
+  bool Contains(const std::string& name) const;
+
+  // 原子地占用一个用户名。并发注册同一用户名时只有一个调用成功。
+  // @param name 用户名
+  // @param password 密码
+  // @return 用户名已存在时返回 false
+  bool Insert(const std::string& name, const std::string& password);
+
+  // 删除一个用户，用于撤销写库失败的注册。
+  // @param name 用户名
+  void Erase(const std::string& name);
+
+  // 从 user 表读取全部用户并合并进内存表，已有用户的密码以数据库为准。
+  // 只增不删：数据库中删除的用户在重启前仍然有效。
+  // @param conn_pool 数据库连接池
+  // @return 查询成功返回 true
+  bool Refresh(ConnectionPool* conn_pool);
+
+  // 启动后台线程，每隔 interval_s 秒执行一次 Refresh，
+  // 使其他节点注册的用户在本节点可见。
+  // @param conn_pool 数据库连接池
+  // @param interval_s 刷新间隔（秒），0 表示不启动
+  void StartRefresh(ConnectionPool* conn_pool, int interval_s);
+
+  // 停止后台刷新线程。必须在连接池销毁之前调用。
+  void StopRefresh();
+
+  // @return 用户总数
+  size_t size() const;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+
+  using Table = std::unordered_map<std::string, std::string>;
+
+  struct alignas(64) Shard {
+    std::mutex write_mutex;              // 串行化该分片的写者
+    std::shared_ptr<const Table> table;  // 当前快照，只通过原子操作访问
+  };
+
+  UserStore();
+  ~UserStore();
+
+  const Shard& ShardFor(const std::string& name) const;
+  Shard& ShardFor(const std::string& name);
+
+  // @return 分片当前的快照
+  static std::shared_ptr<const Table> Snapshot(const Shard& shard);
+
+  std::array<Shard, kShardCount> shards_;
+
+  // 后台刷新
+  std::thread refresh_thread_;
+  std::mutex refresh_mutex_;
+  std::condition_variable refresh_cond_;
+  bool refresh_stop_{false};
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_CGIMYSQL_USER_STORE_H_
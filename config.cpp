@@ -55,11 +55,23 @@ Config::Config()
       sql_connection_num_(8),
       thread_num_(8),
       close_log_(0),
-      actor_model_(0) {}
+      log_level_(1),
+      log_binary_(0),
+      access_log_(0),
+      access_log_sample_(1),
+      actor_model_(0),
+      reactor_num_(1),
+      work_stealing_(0),
+      file_cache_mb_(64),
+      file_cache_max_kb_(1024),
+      file_cache_revalidate_ms_(1000),
+      sendfile_threshold_kb_(256),
+      compression_(2),
+      user_refresh_s_(30) {}
 
 void Config::ParseArgs(int argc, char* argv[]) {
   int opt = 0;
-  constexpr const char* kOptString = "p:l:m:o:s:t:c:a:f:h";
+  constexpr const char* kOptString = "p:l:m:o:s:t:c:a:r:w:b:f:h";
 
   while ((opt = getopt(argc, argv, kOptString)) != -1) {
     switch (opt) {
@@ -87,6 +99,15 @@ void Config::ParseArgs(int argc, char* argv[]) {
       case 'a':
         actor_model_ = ParseOrDefault(optarg, actor_model_, 'a');
         break;
+      case 'r':
+        reactor_num_ = ParseOrDefault(optarg, reactor_num_, 'r');
+        break;
+      case 'w':
+        work_stealing_ = ParseOrDefault(optarg, work_stealing_, 'w');
+        break;
+      case 'b':
+        file_cache_mb_ = ParseOrDefault(optarg, file_cache_mb_, 'b');
+        break;
       case 'f':
         if (optarg) {
           LoadFromFile(optarg);
@@ -103,6 +124,9 @@ void Config::ParseArgs(int argc, char* argv[]) {
                   << "  -t <num>          Thread pool size (default: 8)\n"
                   << "  -c <flag>         Close log 0=enable 1=disable (default: 0)\n"
                   << "  -a <model>        Actor model 0=proactor 1=reactor (default: 0)\n"
+                  << "  -r <num>          Sub-reactor (event loop) count (default: 1)\n"
+                  << "  -w <flag>         Work-stealing thread pool 0=off 1=on (default: 0)\n"
+                  << "  -b <MB>           Static file cache budget, 0=off (default: 64)\n"
                   << "  -f <file>         Load config from file\n"
                   << "  -h                Show this help message\n";
         break;
@@ -154,6 +178,16 @@ bool Config::LoadFromFile(const std::string& config_file) {
 }
 
 void Config::ParseConfigLine(const std::string& key, const std::string& value) {
+  // 字符串类型的配置项
+  if (key == "cache_control") {
+    AddCacheControlRule(value);
+    return;
+  }
+  if (key == "mime_types_file") {
+    mime_types_file_ = value;
+    return;
+  }
+
   auto int_value = ParseInt(value);
   if (!int_value) {
     std::cerr << "[Config] Invalid integer value for " << key 
@@ -179,13 +213,50 @@ void Config::ParseConfigLine(const std::string& key, const std::string& value) {
     thread_num_ = *int_value;
   } else if (key == "close_log") {
     close_log_ = *int_value;
+  } else if (key == "log_level") {
+    log_level_ = *int_value;
+  } else if (key == "log_binary") {
+    log_binary_ = *int_value;
+  } else if (key == "access_log") {
+    access_log_ = *int_value;
+  } else if (key == "access_log_sample") {
+    access_log_sample_ = *int_value;
   } else if (key == "actor_model") {
     actor_model_ = *int_value;
+  } else if (key == "reactor_num") {
+    reactor_num_ = *int_value;
+  } else if (key == "work_stealing") {
+    work_stealing_ = *int_value;
+  } else if (key == "file_cache_mb") {
+    file_cache_mb_ = *int_value;
+  } else if (key == "file_cache_max_kb") {
+    file_cache_max_kb_ = *int_value;
+  } else if (key == "file_cache_revalidate_ms") {
+    file_cache_revalidate_ms_ = *int_value;
+  } else if (key == "sendfile_threshold_kb") {
+    sendfile_threshold_kb_ = *int_value;
+  } else if (key == "compression") {
+    compression_ = *int_value;
+  } else if (key == "user_refresh_s") {
+    user_refresh_s_ = *int_value;
   } else {
     std::cerr << "[Config] Unknown configuration key: " << key << std::endl;
   }
 }
 
+void Config::AddCacheControlRule(const std::string& value) {
+  size_t space = value.find_first_of(" \t");
+  std::string prefix = value.substr(0, space);
+  std::string directives =
+      space == std::string::npos ? "" : Trim(value.substr(space));
+  if (prefix.empty() || prefix[0] != '/' || directives.empty()) {
+    std::cerr << "[Config] Invalid cache_control rule: " << value
+              << " (expected \"<url prefix> <directives>\")" << std::endl;
+    return;
+  }
+  cache_control_rules_.emplace_back(prefix, directives);
+}
+
 std::optional<int> Config::ParseInt(const std::string& str) const {
   try {
     return std::stoi(str);
@@ -227,6 +298,79 @@ bool Config::Validate() const {
     valid = false;
   }
 
+  if (reactor_num_ <= 0 || reactor_num_ > 128) {
+    std::cerr << "[Config] Invalid reactor_num: " << reactor_num_
+              << " (must be between 1 and 128)" << std::endl;
+    valid = false;
+  }
+
+  if (work_stealing_ < 0 || work_stealing_ > 1) {
+    std::cerr << "[Config] Invalid work_stealing: " << work_stealing_
+              << " (must be 0 or 1)" << std::endl;
+    valid = false;
+  }
+
+  if (file_cache_mb_ < 0 || file_cache_mb_ > 65536) {
+    std::cerr << "[Config] Invalid file_cache_mb: " << file_cache_mb_
+              << " (must be between 0 and 65536)" << std::endl;
+    valid = false;
+  }
+
+  if (file_cache_max_kb_ <= 0 || file_cache_max_kb_ > 1048576) {
+    std::cerr << "[Config] Invalid file_cache_max_kb: " << file_cache_max_kb_
+              << " (must be between 1 and 1048576)" << std::endl;
+    valid = false;
+  }
+
+  if (file_cache_revalidate_ms_ < 0) {
+    std::cerr << "[Config] Invalid file_cache_revalidate_ms: "
+              << file_cache_revalidate_ms_ << " (must be >= 0)" << std::endl;
+    valid = false;
+  }
+
+  if (sendfile_threshold_kb_ < 0 || sendfile_threshold_kb_ > 1048576) {
+    std::cerr << "[Config] Invalid sendfile_threshold_kb: "
+              << sendfile_threshold_kb_ << " (must be between 0 and 1048576)"
+              << std::endl;
+    valid = false;
+  }
+
+  if (compression_ < 0 || compression_ > 2) {
+    std::cerr << "[Config] Invalid compression: " << compression_
+              << " (must be 0, 1 or 2)" << std::endl;
+    valid = false;
+  }
+
+  if (log_level_ < 0 || log_level_ > 3) {
+    std::cerr << "[Config] Invalid log_level: " << log_level_
+              << " (must be between 0 and 3)" << std::endl;
+    valid = false;
+  }
+
+  if (log_binary_ != 0 && log_binary_ != 1) {
+    std::cerr << "[Config] Invalid log_binary: " << log_binary_
+              << " (must be 0 or 1)" << std::endl;
+    valid = false;
+  }
+
+  if (access_log_ < 0 || access_log_ > 2) {
+    std::cerr << "[Config] Invalid access_log: " << access_log_
+              << " (must be 0, 1 or 2)" << std::endl;
+    valid = false;
+  }
+
+  if (access_log_sample_ < 1) {
+    std::cerr << "[Config] Invalid access_log_sample: " << access_log_sample_
+              << " (must be at least 1)" << std::endl;
+    valid = false;
+  }
+
+  if (user_refresh_s_ < 0 || user_refresh_s_ > 86400) {
+    std::cerr << "[Config] Invalid user_refresh_s: " << user_refresh_s_
+              << " (must be between 0 and 86400)" << std::endl;
+    valid = false;
+  }
+
   return valid;
 }
 
@@ -243,8 +387,44 @@ void Config::Print() const {
   std::cout << "Thread Pool Size:    " << thread_num_ << std::endl;
   std::cout << "Log Disabled:        " << close_log_ 
             << (close_log_ == 0 ? " (enabled)" : " (disabled)") << std::endl;
+  static const char* const kLevelNames[] = {"debug", "info", "warn", "error"};
+  std::cout << "Log Level:           " << log_level_ << " ("
+            << (log_level_ >= 0 && log_level_ <= 3 ? kLevelNames[log_level_]
+                                                  : "invalid")
+            << ")" << std::endl;
+  std::cout << "Log Format:          " << log_binary_
+            << (log_binary_ == 0 ? " (text)" : " (binary)") << std::endl;
+  static const char* const kAccessLogNames[] = {"off", "combined", "json"};
+  std::cout << "Access Log:          " << access_log_ << " ("
+            << (access_log_ >= 0 && access_log_ <= 2
+                    ? kAccessLogNames[access_log_]
+                    : "invalid")
+            << "), sample 1/" << access_log_sample_ << std::endl;
   std::cout << "Actor Model:         " << actor_model_ 
             << (actor_model_ == 0 ? " (proactor)" : " (reactor)") << std::endl;
+  std::cout << "Sub-reactors:        " << reactor_num_ << std::endl;
+  std::cout << "Work Stealing:       " << work_stealing_
+            << (work_stealing_ == 0 ? " (locked queue)" : " (work stealing)")
+            << std::endl;
+  std::cout << "File Cache:          " << file_cache_mb_ << " MB, max "
+            << file_cache_max_kb_ << " KB/file, revalidate every "
+            << file_cache_revalidate_ms_ << " ms" << std::endl;
+  std::cout << "Sendfile Threshold:  " << sendfile_threshold_kb_ << " KB"
+            << (sendfile_threshold_kb_ == 0 ? " (disabled)" : "") << std::endl;
+  std::cout << "Compression:         " << compression_
+            << (compression_ == 0   ? " (off)"
+                : compression_ == 1 ? " (precompressed only)"
+                                    : " (precompressed + in-memory)")
+            << std::endl;
+  std::cout << "User Refresh:        " << user_refresh_s_ << " s"
+            << (user_refresh_s_ == 0 ? " (disabled)" : "") << std::endl;
+  if (!mime_types_file_.empty()) {
+    std::cout << "MIME Types File:     " << mime_types_file_ << std::endl;
+  }
+  for (const auto& rule : cache_control_rules_) {
+    std::cout << "Cache-Control:       " << rule.first << " -> " << rule.second
+              << std::endl;
+  }
   std::cout << "===========================" << std::endl;
 }
 
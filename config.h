@@ -8,6 +8,8 @@
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace tinywebserver {
 
@@ -53,7 +55,26 @@ class Config {
   int sql_connection_num() const { return sql_connection_num_; }
   int thread_num() const { return thread_num_; }
   int close_log() const { return close_log_; }
+  int log_level() const { return log_level_; }
+  int log_binary() const { return log_binary_; }
+  int access_log() const { return access_log_; }
+  int access_log_sample() const { return access_log_sample_; }
   int actor_model() const { return actor_model_; }
+  int reactor_num() const { return reactor_num_; }
+  int work_stealing() const { return work_stealing_; }
+  int file_cache_mb() const { return file_cache_mb_; }
+  int file_cache_max_kb() const { return file_cache_max_kb_; }
+  int file_cache_revalidate_ms() const { return file_cache_revalidate_ms_; }
+  int sendfile_threshold_kb() const { return sendfile_threshold_kb_; }
+  int compression() const { return compression_; }
+  int user_refresh_s() const { return user_refresh_s_; }
+  // (URL prefix, Cache-Control directives) pairs from cache_control lines
+  const std::vector<std::pair<std::string, std::string>>& cache_control_rules()
+      const {
+    return cache_control_rules_;
+  }
+  // Extra MIME types file, empty if none
+  const std::string& mime_types_file() const { return mime_types_file_; }
 
   // Setters (for testing and programmatic configuration)
   void set_port(int port) { port_ = port; }
@@ -62,12 +83,28 @@ class Config {
   void set_sql_connection_num(int num) { sql_connection_num_ = num; }
   void set_thread_num(int num) { thread_num_ = num; }
   void set_close_log(int flag) { close_log_ = flag; }
+  void set_log_level(int level) { log_level_ = level; }
+  void set_log_binary(int flag) { log_binary_ = flag; }
+  void set_access_log(int format) { access_log_ = format; }
+  void set_access_log_sample(int rate) { access_log_sample_ = rate; }
   void set_actor_model(int model) { actor_model_ = model; }
+  void set_reactor_num(int num) { reactor_num_ = num; }
+  void set_work_stealing(int flag) { work_stealing_ = flag; }
+  void set_file_cache_mb(int mb) { file_cache_mb_ = mb; }
+  void set_file_cache_max_kb(int kb) { file_cache_max_kb_ = kb; }
+  void set_file_cache_revalidate_ms(int ms) { file_cache_revalidate_ms_ = ms; }
+  void set_sendfile_threshold_kb(int kb) { sendfile_threshold_kb_ = kb; }
+  void set_compression(int mode) { compression_ = mode; }
+  void set_user_refresh_s(int seconds) { user_refresh_s_ = seconds; }
+  void set_mime_types_file(const std::string& file) { mime_types_file_ = file; }
 
  private:
   // Parses a single configuration key-value pair
   void ParseConfigLine(const std::string& key, const std::string& value);
 
+  // Parses a "<url prefix> <directives>" cache_control value
+  void AddCacheControlRule(const std::string& value);
+
   // Helper to parse integer with validation
   std::optional<int> ParseInt(const std::string& str) const;
 
@@ -80,7 +117,21 @@ class Config {
   int sql_connection_num_;      // Database connection pool size
   int thread_num_;              // Thread pool size
   int close_log_;               // Log disable flag (0=enable, 1=disable)
+  int log_level_;               // Minimum log level (0=debug .. 3=error)
+  int log_binary_;              // Log file format (0=text, 1=binary)
+  int access_log_;              // Access log (0=off, 1=combined, 2=JSON lines)
+  int access_log_sample_;       // Record one request in every N
   int actor_model_;             // Concurrency model (0=proactor, 1=reactor)
+  int reactor_num_;             // Number of sub-reactors (event loop threads)
+  int work_stealing_;           // Thread pool scheduler (0=locked queue, 1=work stealing)
+  int file_cache_mb_;           // Static file cache budget in MB (0=disabled)
+  int file_cache_max_kb_;       // Largest cached static file in KB
+  int file_cache_revalidate_ms_;  // Interval between mtime checks of cached files
+  int sendfile_threshold_kb_;   // Files this large use sendfile (0=never)
+  int compression_;             // 0=off, 1=.br/.gz siblings, 2=also in-memory
+  int user_refresh_s_;          // User table reload interval (0=never)
+  std::vector<std::pair<std::string, std::string>> cache_control_rules_;
+  std::string mime_types_file_;  // Extra "<type> <ext>..." definitions
 };
 
 }  // namespace tinywebserver
@@ -0,0 +1,184 @@
+// Copyright 2025 TinyWebServer
+// 连接缓冲区内存池的实现：线程本地空闲链表 + 共享仓库
+
+#include "buffer_pool.h"
+
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace tinywebserver {
+
+namespace {
+
+// 每个线程最多缓存的空闲块数，超出时把一半移到共享仓库
+constexpr int kThreadCacheLimit = 64;
+// 线程缓存与仓库之间一次转移的块数
+constexpr int kTransferBatch = kThreadCacheLimit / 2;
+// 仓库最多保留的空闲块数，超出的直接还给系统
+constexpr int kDepotLimit = 1024;
+
+// 空闲块的开头用作链表指针
+struct FreeChunk {
+  FreeChunk* next;
+};
+
+void FreeList(FreeChunk* chunk) {
+  while (chunk) {
+    FreeChunk* next = chunk->next;
+    delete[] reinterpret_cast<char*>(chunk);
+    chunk = next;
+  }
+}
+
+// 各线程共享的空闲块仓库。块常在一个线程分配、在另一个线程释放
+// (如主反应堆读、工作线程写)，仓库负责在线程之间平衡
+class Depot {
+ public:
+  // 取出至多 count 块
+  // @return 链表头，*taken 为实际取出的块数
+  FreeChunk* Take(int count, int* taken) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FreeChunk* head = head_;
+    FreeChunk* tail = nullptr;
+    int n = 0;
+    for (FreeChunk* chunk = head_; chunk && n < count; chunk = chunk->next) {
+      tail = chunk;
+      ++n;
+    }
+    if (tail) {
+      head_ = tail->next;
+      tail->next = nullptr;
+    }
+    count_ -= n;
+    *taken = n;
+    return n > 0 ? head : nullptr;
+  }
+
+  // 放回一条链表，超出上限的部分释放
+  void Put(FreeChunk* chunk) {
+    FreeChunk* excess = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      while (chunk) {
+        FreeChunk* next = chunk->next;
+        if (count_ < kDepotLimit) {
+          chunk->next = head_;
+          head_ = chunk;
+          ++count_;
+        } else {
+          chunk->next = excess;
+          excess = chunk;
+        }
+        chunk = next;
+      }
+    }
+    FreeList(excess);
+  }
+
+ private:
+  std::mutex mutex_;
+  FreeChunk* head_{nullptr};
+  int count_{0};
+};
+
+// 有意不析构：线程退出时的线程缓存析构可能晚于静态对象析构
+Depot& GetDepot() {
+  static Depot* depot = new Depot;
+  return *depot;
+}
+
+struct ThreadCache {
+  FreeChunk* head{nullptr};
+  int count{0};
+
+  // 线程退出时把缓存的块交给仓库
+  ~ThreadCache() { GetDepot().Put(head); }
+};
+
+thread_local ThreadCache t_cache;
+
+}  // namespace
+
+char* BufferPool::Allocate() {
+  ThreadCache& cache = t_cache;
+  if (cache.head == nullptr) {
+    cache.head = GetDepot().Take(kTransferBatch, &cache.count);
+    if (cache.head == nullptr) {
+      return new char[kChunkSize];
+    }
+  }
+  FreeChunk* chunk = cache.head;
+  cache.head = chunk->next;
+  --cache.count;
+  return reinterpret_cast<char*>(chunk);
+}
+
+void BufferPool::Release(char* chunk) {
+  ThreadCache& cache = t_cache;
+  cache.head = new (chunk) FreeChunk{cache.head};
+  if (++cache.count <= kThreadCacheLimit) {
+    return;
+  }
+  // 线程缓存过大，把最近释放的一批块移到仓库
+  FreeChunk* spill = cache.head;
+  FreeChunk* tail = spill;
+  for (int i = 1; i < kTransferBatch; ++i) {
+    tail = tail->next;
+  }
+  cache.head = tail->next;
+  tail->next = nullptr;
+  cache.count -= kTransferBatch;
+  GetDepot().Put(spill);
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : data_(other.data_), capacity_(other.capacity_) {
+  other.data_ = nullptr;
+  other.capacity_ = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+  if (this != &other) {
+    Reset();
+    data_ = std::exchange(other.data_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+  }
+  return *this;
+}
+
+void PooledBuffer::Allocate(size_t capacity) {
+  Reset();
+  if (capacity <= BufferPool::kChunkSize) {
+    data_ = BufferPool::Allocate();
+    capacity_ = BufferPool::kChunkSize;
+  } else {
+    data_ = new char[capacity];
+    capacity_ = capacity;
+  }
+}
+
+void PooledBuffer::Grow(size_t capacity, size_t used) {
+  PooledBuffer larger;
+  larger.Allocate(capacity);
+  if (used > 0) {
+    memcpy(larger.data_, data_, used);
+  }
+  *this = std::move(larger);
+}
+
+void PooledBuffer::Reset() {
+  if (data_ == nullptr) {
+    return;
+  }
+  if (capacity_ == BufferPool::kChunkSize) {
+    BufferPool::Release(data_);
+  } else {
+    delete[] data_;
+  }
+  data_ = nullptr;
+  capacity_ = 0;
+}
+
+}  // namespace tinywebserver
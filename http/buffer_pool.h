@@ -0,0 +1,68 @@
+// Copyright 2025 TinyWebServer
+// Pooled fixed-size chunks for connection read/write buffers
+// Follows Google C++ Style Guide
+
+#ifndef TINYWEBSERVER_HTTP_BUFFER_POOL_H_
+#define TINYWEBSERVER_HTTP_BUFFER_POOL_H_
+
+#include <cstddef>
+
+namespace tinywebserver {
+
+// Hands out kChunkSize-byte chunks. Every thread keeps its own free list,
+// so allocating and releasing normally take no lock. A chunk may be
+// released on a different thread than the one that allocated it; a list
+// that grows past its limit moves half of its chunks to a shared depot,
+// which empty lists are refilled from and which frees chunks beyond its
+// own limit, so memory held for idle connections is bounded.
+class BufferPool {
+ public:
+  static constexpr size_t kChunkSize = 4096;
+
+  // @return An uninitialized chunk of kChunkSize bytes
+  static char* Allocate();
+
+  // Returns a chunk obtained from Allocate().
+  static void Release(char* chunk);
+};
+
+// Owning handle to a connection buffer. Buffers of BufferPool::kChunkSize
+// bytes come from the pool; larger ones, needed only for oversized
+// requests, are plain heap blocks.
+class PooledBuffer {
+ public:
+  PooledBuffer() = default;
+  ~PooledBuffer() { Reset(); }
+
+  PooledBuffer(PooledBuffer&& other) noexcept;
+  PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+  // Disable copy operations
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+  char* data() const { return data_; }
+  size_t capacity() const { return capacity_; }
+  explicit operator bool() const { return data_ != nullptr; }
+
+  // Acquires storage, releasing any held before. Contents are undefined.
+  // @param capacity Bytes; up to BufferPool::kChunkSize yields a pooled
+  //        chunk of exactly that size
+  void Allocate(size_t capacity);
+
+  // Moves to larger storage.
+  // @param capacity New size in bytes
+  // @param used Leading bytes to carry over
+  void Grow(size_t capacity, size_t used);
+
+  // Returns the storage to the pool or the heap.
+  void Reset();
+
+ private:
+  char* data_{nullptr};
+  size_t capacity_{0};
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_HTTP_BUFFER_POOL_H_
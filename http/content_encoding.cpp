@@ -0,0 +1,202 @@
+// Copyright 2025 TinyWebServer
+// 内容编码协商与压缩的实现
+
+#include "content_encoding.h"
+
+#include <strings.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef TINYWEBSERVER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TINYWEBSERVER_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace tinywebserver {
+
+namespace {
+
+// 值得压缩的文本类文件扩展名
+const char* const kCompressibleExtensions[] = {
+    ".html", ".htm", ".css", ".js",  ".mjs", ".json",
+    ".xml",  ".svg", ".txt", ".map", ".csv", ".md"};
+
+// 压缩只在文件首次被请求时做一次，结果常驻缓存，因此选用较高的压缩级别
+constexpr int kGzipLevel = 9;
+constexpr int kBrotliQuality = 9;
+
+// 比较 name 是否为指定的编码名（不区分大小写）
+bool TokenEquals(std::string_view name, const char* token) {
+  return strlen(token) == name.size() &&
+         strncasecmp(name.data(), token, name.size()) == 0;
+}
+
+#if defined(TINYWEBSERVER_HAVE_ZLIB) || defined(TINYWEBSERVER_HAVE_BROTLI)
+// 压缩缓冲区按最坏情况分配，约与原文件一样大；缓存按压缩后的长度计入预算，
+// 因此复制到恰好大小的缓冲区再交出
+void ShrinkTo(std::unique_ptr<char[]> buffer, size_t size,
+              std::unique_ptr<char[]>* out, size_t* out_size) {
+  out->reset(new char[size > 0 ? size : 1]);
+  std::memcpy(out->get(), buffer.get(), size);
+  *out_size = size;
+}
+#endif
+
+}  // namespace
+
+const char* EncodingToken(ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::kGzip:
+      return "gzip";
+    case ContentEncoding::kBrotli:
+      return "br";
+    case ContentEncoding::kIdentity:
+      break;
+  }
+  return "identity";
+}
+
+const char* EncodingSuffix(ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::kGzip:
+      return ".gz";
+    case ContentEncoding::kBrotli:
+      return ".br";
+    case ContentEncoding::kIdentity:
+      break;
+  }
+  return "";
+}
+
+bool AcceptsEncoding(std::string_view accept_encoding,
+                     ContentEncoding encoding) {
+  const char* token = EncodingToken(encoding);
+  int wildcard = -1;  // -1 表示未出现 *，0 不接受，1 接受
+  std::string_view rest = accept_encoding;
+  while (true) {
+    size_t start = rest.find_first_not_of(" \t,");
+    if (start == std::string_view::npos) break;
+    rest.remove_prefix(start);
+
+    std::string_view element = rest.substr(0, rest.find(','));
+    rest.remove_prefix(element.size());
+    std::string_view name = element.substr(0, element.find_first_of(" \t;"));
+    // 参数中只关心 q 值，q=0 表示明确拒绝
+    bool accepted = true;
+    size_t param = element.find(';');
+    if (param != std::string_view::npos) {
+      param = element.find_first_not_of(" \t", param + 1);
+      if (param != std::string_view::npos && param + 1 < element.size() &&
+          (element[param] == 'q' || element[param] == 'Q') &&
+          element[param + 1] == '=') {
+        // q 值最多形如 "0.001"，复制出来以便 strtod 在元素末尾停止
+        char q[8] = {};
+        element.copy(q, sizeof(q) - 1, param + 2);
+        accepted = strtod(q, nullptr) > 0;
+      }
+    }
+
+    if (TokenEquals(name, token) ||
+        (encoding == ContentEncoding::kGzip && TokenEquals(name, "x-gzip"))) {
+      return accepted;
+    }
+    if (TokenEquals(name, "*")) {
+      wildcard = accepted ? 1 : 0;
+    }
+  }
+  return wildcard == 1;
+}
+
+bool IsCompressible(const char* path) {
+  const char* ext = strrchr(path, '.');
+  if (!ext || strchr(ext, '/')) {
+    return false;
+  }
+  for (const char* candidate : kCompressibleExtensions) {
+    if (strcasecmp(ext, candidate) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CanCompress(ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::kGzip:
+#ifdef TINYWEBSERVER_HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    case ContentEncoding::kBrotli:
+#ifdef TINYWEBSERVER_HAVE_BROTLI
+      return true;
+#else
+      return false;
+#endif
+    case ContentEncoding::kIdentity:
+      break;
+  }
+  return false;
+}
+
+bool Compress(ContentEncoding encoding, const char* data, size_t size,
+              std::unique_ptr<char[]>* out, size_t* out_size) {
+  switch (encoding) {
+#ifdef TINYWEBSERVER_HAVE_ZLIB
+    case ContentEncoding::kGzip: {
+      z_stream stream;
+      std::memset(&stream, 0, sizeof(stream));
+      // windowBits + 16 生成 gzip 封装而不是 zlib 封装
+      if (deflateInit2(&stream, kGzipLevel, Z_DEFLATED, 15 + 16, 8,
+                       Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+      }
+      uLong bound = deflateBound(&stream, size);
+      std::unique_ptr<char[]> buffer(new char[bound]);
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+      stream.avail_in = static_cast<uInt>(size);
+      stream.next_out = reinterpret_cast<Bytef*>(buffer.get());
+      stream.avail_out = static_cast<uInt>(bound);
+      int ret = deflate(&stream, Z_FINISH);
+      size_t encoded_size = stream.total_out;
+      deflateEnd(&stream);
+      if (ret != Z_STREAM_END) {
+        return false;
+      }
+      ShrinkTo(std::move(buffer), encoded_size, out, out_size);
+      return true;
+    }
+#endif
+#ifdef TINYWEBSERVER_HAVE_BROTLI
+    case ContentEncoding::kBrotli: {
+      size_t bound = BrotliEncoderMaxCompressedSize(size);
+      if (bound == 0) {
+        return false;
+      }
+      std::unique_ptr<char[]> buffer(new char[bound]);
+      size_t encoded_size = bound;
+      if (!BrotliEncoderCompress(
+              kBrotliQuality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, size,
+              reinterpret_cast<const uint8_t*>(data), &encoded_size,
+              reinterpret_cast<uint8_t*>(buffer.get()))) {
+        return false;
+      }
+      ShrinkTo(std::move(buffer), encoded_size, out, out_size);
+      return true;
+    }
+#endif
+    default:
+      break;
+  }
+  (void)data;
+  (void)size;
+  (void)out;
+  (void)out_size;
+  return false;
+}
+
+}  // namespace tinywebserver
@@ -0,0 +1,53 @@
+// Copyright 2025 TinyWebServer
+// Accept-Encoding negotiation and in-memory compression of static files
+// Follows Google C++ Style Guide
+
+#ifndef TINYWEBSERVER_HTTP_CONTENT_ENCODING_H_
+#define TINYWEBSERVER_HTTP_CONTENT_ENCODING_H_
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace tinywebserver {
+
+// Content codings the server can send
+enum class ContentEncoding {
+  kIdentity = 0,
+  kGzip,
+  kBrotli
+};
+
+// @return Coding name used in Content-Encoding, e.g. "gzip"
+const char* EncodingToken(ContentEncoding encoding);
+
+// @return File name suffix of a precompressed sibling, e.g. ".gz"
+const char* EncodingSuffix(ContentEncoding encoding);
+
+// Checks whether an Accept-Encoding value allows a coding, honouring q=0
+// and the "*" wildcard.
+// @param accept_encoding Accept-Encoding header value
+// @param encoding Coding to check
+bool AcceptsEncoding(std::string_view accept_encoding,
+                     ContentEncoding encoding);
+
+// @return true if the file type is text-like and worth compressing
+bool IsCompressible(const char* path);
+
+// @return true if this build can compress with the coding (zlib for gzip,
+//         libbrotlienc for brotli)
+bool CanCompress(ContentEncoding encoding);
+
+// Compresses a buffer in one shot.
+// @param encoding kGzip or kBrotli
+// @param data Input bytes
+// @param size Input size
+// @param out Output parameter, owns the compressed bytes
+// @param out_size Output parameter, compressed size
+// @return false if the coding is unavailable or compression failed
+bool Compress(ContentEncoding encoding, const char* data, size_t size,
+              std::unique_ptr<char[]>* out, size_t* out_size);
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_HTTP_CONTENT_ENCODING_H_
@@ -0,0 +1,349 @@
+// Copyright 2025 TinyWebServer
+// 静态文件缓存的实现
+
+#include "file_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+namespace tinywebserver {
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool SameFile(const struct stat& a, const struct stat& b) {
+  return a.st_ino == b.st_ino && a.st_dev == b.st_dev &&
+         a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+         a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+// 小文件压缩后省下的字节抵不过压缩格式本身的开销
+constexpr size_t kMinCompressSize = 256;
+
+// 取文件元数据并检查是否可以作为静态文件发送
+FileCache::Status StatPath(const std::string& path, struct stat* st) {
+  if (stat(path.c_str(), st) < 0) {
+    return FileCache::Status::kNotFound;
+  }
+  if (!(st->st_mode & S_IROTH)) {
+    return FileCache::Status::kForbidden;
+  }
+  if (S_ISDIR(st->st_mode)) {
+    return FileCache::Status::kDirectory;
+  }
+  return FileCache::Status::kOk;
+}
+
+}  // namespace
+
+void FormatETag(const struct stat& st, char* buf, size_t len,
+                const char* suffix) {
+  uint64_t mtime_ns = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000u +
+                      static_cast<uint64_t>(st.st_mtim.tv_nsec);
+  snprintf(buf, len, "\"%" PRIx64 "-%" PRIx64 "-%" PRIx64 "%s%s\"",
+           static_cast<uint64_t>(st.st_ino), static_cast<uint64_t>(st.st_size),
+           mtime_ns, *suffix ? "-" : "", suffix);
+}
+
+void FormatHttpDate(time_t time, char* buf, size_t len) {
+  struct tm tm;
+  gmtime_r(&time, &tm);
+  strftime(buf, len, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+// CachedFile 实现
+
+CachedFile::~CachedFile() {
+  if (data_ && !buffer_) {
+    munmap(data_, size());
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+// FileCache 实现
+
+FileCache::FileCache()
+    : shard_budget_(0),
+      max_entry_size_(0),
+      sendfile_threshold_(0),
+      revalidate_interval_(0) {}
+
+FileCache* FileCache::GetInstance() {
+  static FileCache file_cache;
+  return &file_cache;
+}
+
+void FileCache::Init(size_t memory_budget, size_t max_entry_size,
+                     int revalidate_interval_ms, size_t sendfile_threshold) {
+  Clear();
+  shard_budget_ = memory_budget / kShardCount;
+  max_entry_size_ = max_entry_size;
+  sendfile_threshold_ = sendfile_threshold;
+  revalidate_interval_ = std::chrono::milliseconds(
+      revalidate_interval_ms > 0 ? revalidate_interval_ms : 0);
+}
+
+FileCache::Shard& FileCache::ShardFor(const std::string& path) {
+  return shards_[std::hash<std::string>()(path) % kShardCount];
+}
+
+std::shared_ptr<CachedFile> FileCache::Lookup(
+    Shard& shard, const std::string& key, const std::string& validate_path) {
+  std::shared_ptr<CachedFile> cached;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      // 命中后移动到 LRU 表头
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      cached = it->second->second;
+    }
+  }
+
+  if (cached && !Revalidate(validate_path, cached.get())) {
+    // 文件已被修改，丢弃旧条目
+    Erase(shard, key, cached.get());
+    cached.reset();
+  }
+  return cached;
+}
+
+FileCache::Status FileCache::Acquire(const std::string& path,
+                                     std::shared_ptr<const CachedFile>* file) {
+  Shard& shard = ShardFor(path);
+  if (auto cached = Lookup(shard, path, path)) {
+    *file = std::move(cached);
+    return Status::kOk;
+  }
+
+  struct stat st;
+  Status status = StatPath(path, &st);
+  if (status != Status::kOk) {
+    return status;
+  }
+
+  std::shared_ptr<CachedFile> loaded;
+  status = Load(path, &loaded);
+  if (status != Status::kOk) {
+    return status;
+  }
+
+  // 超过单条上限或分片预算的文件不进入缓存，响应结束后即释放；
+  // 只有 fd 的 sendfile 文件不占内存预算，只受单条上限限制
+  bool cacheable = loaded->data()
+                       ? Cacheable(loaded->size())
+                       : shard_budget_ > 0 && loaded->size() <= max_entry_size_;
+  if (cacheable) {
+    Insert(shard, path, loaded);
+  }
+  *file = std::move(loaded);
+  return Status::kOk;
+}
+
+FileCache::Status FileCache::AcquireCompressed(
+    const std::string& path, ContentEncoding encoding,
+    std::shared_ptr<const CachedFile>* file) {
+  // 压缩副本与原文件分开缓存；键中的 '\0' 保证不会与真实路径冲突
+  std::string key = path;
+  key.push_back('\0');
+  key += EncodingToken(encoding);
+  Shard& shard = ShardFor(key);
+  if (auto cached = Lookup(shard, key, path)) {
+    *file = std::move(cached);
+    return Status::kOk;
+  }
+
+  std::shared_ptr<const CachedFile> source;
+  Status status = Acquire(path, &source);
+  if (status != Status::kOk) {
+    return status;
+  }
+  // 只压缩能进入缓存的已映射文件，否则每次请求都要重新压缩
+  if (!source->data() || source->size() < kMinCompressSize ||
+      !Cacheable(source->size())) {
+    return Status::kError;
+  }
+
+  auto compressed = std::make_shared<CachedFile>();
+  if (!Compress(encoding, source->data(), source->size(), &compressed->buffer_,
+                &compressed->size_)) {
+    return Status::kError;
+  }
+  compressed->data_ = compressed->buffer_.get();
+  compressed->stat_ = source->stat_;
+  FormatETag(compressed->stat_, compressed->etag_, sizeof(compressed->etag_),
+             EncodingToken(encoding));
+  std::memcpy(compressed->last_modified_, source->last_modified_,
+              sizeof(compressed->last_modified_));
+  compressed->validated_at_.store(
+      source->validated_at_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+
+  Insert(shard, key, compressed);
+  *file = std::move(compressed);
+  return Status::kOk;
+}
+
+FileCache::Status FileCache::Load(const std::string& path,
+                                  std::shared_ptr<CachedFile>* file) const {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return Status::kError;
+  }
+
+  auto loaded = std::make_shared<CachedFile>();
+  loaded->fd_ = fd;
+  // 以打开后的 fstat 为准，避免 stat 与 open 之间文件被替换
+  if (fstat(fd, &loaded->stat_) < 0 || S_ISDIR(loaded->stat_.st_mode)) {
+    return Status::kError;
+  }
+  loaded->size_ = static_cast<size_t>(loaded->stat_.st_size);
+
+  // 大文件只保留 fd，由 sendfile 发送
+  bool use_sendfile =
+      sendfile_threshold_ > 0 && loaded->size() >= sendfile_threshold_;
+  if (loaded->size() > 0 && !use_sendfile) {
+    void* data = mmap(nullptr, loaded->size(), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      return Status::kError;
+    }
+    loaded->data_ = static_cast<char*>(data);
+  }
+  FormatETag(loaded->stat_, loaded->etag_, sizeof(loaded->etag_));
+  FormatHttpDate(loaded->stat_.st_mtime, loaded->last_modified_,
+                 sizeof(loaded->last_modified_));
+  loaded->validated_at_.store(NowNs(), std::memory_order_relaxed);
+
+  *file = std::move(loaded);
+  return Status::kOk;
+}
+
+FileCache::Status FileCache::Stat(const std::string& path, struct stat* st) {
+  if (auto cached = Lookup(ShardFor(path), path, path)) {
+    *st = cached->stat_;
+    return Status::kOk;
+  }
+  return StatPath(path, st);
+}
+
+bool FileCache::HasSibling(const std::string& path,
+                           ContentEncoding encoding) {
+  std::string sibling = path + EncodingSuffix(encoding);
+  std::shared_ptr<CachedFile> original = Lookup(ShardFor(path), path, path);
+  if (!original) {
+    struct stat st;
+    return Stat(sibling, &st) == Status::kOk;
+  }
+
+  // 不存在的结果记在原文件的条目上，复查间隔内不再 stat
+  auto& missing_at =
+      original->sibling_missing_at_[static_cast<size_t>(encoding)];
+  int64_t now = NowNs();
+  int64_t checked = missing_at.load(std::memory_order_relaxed);
+  if (checked != 0 && revalidate_interval_.count() > 0 &&
+      now - checked < revalidate_interval_.count()) {
+    return false;
+  }
+  struct stat st;
+  bool found = Stat(sibling, &st) == Status::kOk;
+  missing_at.store(found ? 0 : now, std::memory_order_relaxed);
+  return found;
+}
+
+bool FileCache::Revalidate(const std::string& path, CachedFile* file) const {
+  int64_t now = NowNs();
+  int64_t validated_at = file->validated_at_.load(std::memory_order_relaxed);
+  if (revalidate_interval_.count() > 0 &&
+      now - validated_at < revalidate_interval_.count()) {
+    return true;
+  }
+
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0 || !SameFile(st, file->stat_) ||
+      !(st.st_mode & S_IROTH)) {
+    return false;
+  }
+  file->validated_at_.store(now, std::memory_order_relaxed);
+  return true;
+}
+
+void FileCache::Insert(Shard& shard, const std::string& path,
+                       const std::shared_ptr<CachedFile>& file) {
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // 并发加载同一文件时，以最后插入的为准
+  auto it = shard.index.find(path);
+  if (it != shard.index.end()) {
+    Account(shard, *it->second->second, false);
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+  }
+
+  shard.lru.emplace_front(path, file);
+  shard.index[path] = shard.lru.begin();
+  Account(shard, *file, true);
+
+  while (shard.bytes > shard_budget_ && shard.lru.size() > 1) {
+    auto& victim = shard.lru.back();
+    Account(shard, *victim.second, false);
+    shard.index.erase(victim.first);
+    shard.lru.pop_back();
+  }
+
+  // fd-only 条目超出上限时只淘汰其中最久未用的，不影响已映射的小文件
+  auto victim = shard.lru.end();
+  while (shard.fd_entries > kMaxFdEntriesPerShard) {
+    do {
+      --victim;
+    } while (victim->second->data() != nullptr);
+    Account(shard, *victim->second, false);
+    shard.index.erase(victim->first);
+    victim = shard.lru.erase(victim);
+  }
+}
+
+void FileCache::Account(Shard& shard, const CachedFile& file, bool add) {
+  // 已映射或在内存中的条目按字节计入预算，只有 fd 的条目按个数计
+  if (file.data() != nullptr) {
+    shard.bytes = add ? shard.bytes + file.size() : shard.bytes - file.size();
+  } else {
+    shard.fd_entries = add ? shard.fd_entries + 1 : shard.fd_entries - 1;
+  }
+}
+
+void FileCache::Erase(Shard& shard, const std::string& path,
+                      const CachedFile* file) {
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(path);
+  if (it == shard.index.end() || it->second->second.get() != file) {
+    return;
+  }
+  Account(shard, *file, false);
+  shard.lru.erase(it->second);
+  shard.index.erase(it);
+}
+
+void FileCache::Clear() {
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.index.clear();
+    shard.lru.clear();
+    shard.bytes = 0;
+    shard.fd_entries = 0;
+  }
+}
+
+}  // namespace tinywebserver
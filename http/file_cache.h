@@ -0,0 +1,219 @@
+// Copyright 2025 TinyWebServer
+// Shared open-file / mmap cache for static content
+// Follows Google C++ Style Guide
+
+#ifndef TINYWEBSERVER_HTTP_FILE_CACHE_H_
+#define TINYWEBSERVER_HTTP_FILE_CACHE_H_
+
+#include <sys/stat.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "content_encoding.h"
+
+namespace tinywebserver {
+
+// Formats the strong entity tag of a file version from its inode, size and
+// modification time, e.g. "2f1a3-14468-1856a0c1f2a9b3c1".
+// @param st File metadata
+// @param buf Output buffer
+// @param len Buffer size, 64 bytes always suffice
+// @param suffix Appended inside the quotes to tell encoded variants apart
+void FormatETag(const struct stat& st, char* buf, size_t len,
+                const char* suffix = "");
+
+// Formats a time as an HTTP-date (IMF-fixdate), e.g.
+// "Sun, 06 Nov 1994 08:49:37 GMT".
+// @param time Seconds since the epoch
+// @param buf Output buffer
+// @param len Buffer size, 32 bytes always suffice
+void FormatHttpDate(time_t time, char* buf, size_t len);
+
+// A static file kept open and mapped for as long as anyone references it.
+// The mapping and fd are released when the last reference goes away, so an
+// entry evicted or invalidated while a response is in flight stays valid
+// for that response. A compressed variant holds its bytes in memory instead
+// and keeps the metadata of the file it was compressed from.
+class CachedFile {
+ public:
+  CachedFile() = default;
+  ~CachedFile();
+
+  // Disable copy and move operations
+  CachedFile(const CachedFile&) = delete;
+  CachedFile& operator=(const CachedFile&) = delete;
+  CachedFile(CachedFile&&) = delete;
+  CachedFile& operator=(CachedFile&&) = delete;
+
+  // @return Mapped contents, null for empty files and for files sent with
+  //         sendfile
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  int fd() const { return fd_; }
+  const struct stat& file_stat() const { return stat_; }
+  // Validators of the loaded version, formatted once at load time
+  const char* etag() const { return etag_; }
+  const char* last_modified() const { return last_modified_; }
+
+ private:
+  friend class FileCache;
+
+  int fd_{-1};             // Open read-only fd (for sendfile)
+  char* data_{nullptr};    // Read-only mapping, null if not mapped
+  size_t size_{0};         // Bytes of content
+  std::unique_ptr<char[]> buffer_;  // Owns data_ for compressed variants
+  struct stat stat_ {};    // Metadata at load time
+  char etag_[64]{};
+  char last_modified_[32]{};
+  // Last time the metadata was checked against the file system (ns since
+  // the steady_clock epoch); updated by concurrent readers.
+  std::atomic<int64_t> validated_at_{0};
+  // Per ContentEncoding, when the precompressed sibling (.gz/.br) was last
+  // found missing (same clock), 0 if unknown
+  std::atomic<int64_t> sibling_missing_at_[3]{};
+};
+
+// Sharded, reference-counted cache of CachedFile keyed by resolved path.
+// Each shard is an LRU list under its own mutex and gets an equal slice of
+// the memory budget. Hits are revalidated with stat() at most once per
+// revalidate interval; a changed inode, size or mtime drops the entry.
+// Files larger than the max entry size are served through an uncached
+// CachedFile that is released after the response. Files at or above the
+// sendfile threshold are only opened, never mapped, so serving them costs
+// no address space regardless of their size; such fd-only entries are not
+// charged against the memory budget but capped per shard by count instead.
+// Compressed variants of text files share the same shards and budget,
+// keyed by path and coding.
+class FileCache {
+ public:
+  // Result of a lookup
+  enum class Status {
+    kOk = 0,
+    kNotFound,    // stat() failed
+    kForbidden,   // Not world-readable
+    kDirectory,   // Path is a directory
+    kError        // open() or mmap() failed
+  };
+
+  // Gets the singleton instance.
+  static FileCache* GetInstance();
+
+  // Configures the cache. Call before serving requests.
+  // @param memory_budget Total bytes of mapped files kept cached, 0 disables
+  // @param max_entry_size Largest file size that is cached
+  // @param revalidate_interval_ms Minimum interval between stat() checks of
+  //        a cached file, 0 checks on every hit
+  // @param sendfile_threshold Smallest file size sent with sendfile instead
+  //        of being mapped, 0 maps every file
+  void Init(size_t memory_budget, size_t max_entry_size,
+            int revalidate_interval_ms, size_t sendfile_threshold);
+
+  // Looks up or loads a file.
+  // @param path Resolved file system path
+  // @param file Output parameter, set when the result is kOk
+  // @return Lookup status
+  Status Acquire(const std::string& path,
+                 std::shared_ptr<const CachedFile>* file);
+
+  // Looks up or builds the compressed variant of a cacheable, mapped file.
+  // The file is compressed once per version; later hits cost no CPU.
+  // @param path Resolved file system path of the original file
+  // @param encoding kGzip or kBrotli
+  // @param file Output parameter, set when the result is kOk
+  // @return Lookup status, kError if the variant cannot be built or cached
+  Status AcquireCompressed(const std::string& path, ContentEncoding encoding,
+                           std::shared_ptr<const CachedFile>* file);
+
+  // @return true if a file of this size fits in the cache
+  bool Cacheable(size_t size) const {
+    return size <= max_entry_size_ && size <= shard_budget_;
+  }
+
+  // Looks up the metadata of a file without opening or mapping it. Cached
+  // files are answered from the cache, others with a single stat().
+  // @param path Resolved file system path
+  // @param st Output parameter, set when the result is kOk
+  // @return Lookup status
+  Status Stat(const std::string& path, struct stat* st);
+
+  // Checks whether a precompressed sibling (path + ".br"/".gz") exists.
+  // A missing sibling is remembered on the cached entry of path until the
+  // revalidate interval elapses, so hits on files without siblings cost no
+  // stat() calls; present siblings are answered like Stat.
+  // @param path Resolved file system path of the original file
+  // @param encoding kGzip or kBrotli
+  // @return true if the sibling exists and is readable
+  bool HasSibling(const std::string& path, ContentEncoding encoding);
+
+  // Drops every cached entry. In-flight references stay valid.
+  void Clear();
+
+ private:
+  static constexpr size_t kShardCount = 16;
+  // Most fd-only (sendfile) entries a shard keeps open
+  static constexpr size_t kMaxFdEntriesPerShard = 64;
+
+  using LruList = std::list<std::pair<std::string, std::shared_ptr<CachedFile>>>;
+
+  struct Shard {
+    std::mutex mutex;
+    LruList lru;  // Most recently used first
+    std::unordered_map<std::string, LruList::iterator> index;
+    size_t bytes{0};       // Mapped or in-memory bytes of the entries
+    size_t fd_entries{0};  // Entries holding only an fd
+  };
+
+  FileCache();
+  ~FileCache() = default;
+
+  // Disable copy and move operations
+  FileCache(const FileCache&) = delete;
+  FileCache& operator=(const FileCache&) = delete;
+  FileCache(FileCache&&) = delete;
+  FileCache& operator=(FileCache&&) = delete;
+
+  Shard& ShardFor(const std::string& path);
+
+  // Returns the cached entry for key if it is still valid, else drops it.
+  // @param validate_path File the entry is revalidated against
+  std::shared_ptr<CachedFile> Lookup(Shard& shard, const std::string& key,
+                                     const std::string& validate_path);
+
+  // Opens a file and maps it unless it is sent with sendfile.
+  Status Load(const std::string& path,
+              std::shared_ptr<CachedFile>* file) const;
+
+  // Checks the entry against the file system if the interval has elapsed.
+  // @return false if the file changed and the entry must be dropped
+  bool Revalidate(const std::string& path, CachedFile* file) const;
+
+  // Inserts an entry and evicts least recently used ones over the budget,
+  // or least recently used fd-only ones over kMaxFdEntriesPerShard.
+  void Insert(Shard& shard, const std::string& path,
+              const std::shared_ptr<CachedFile>& file);
+
+  // Adds or removes an entry's share of the shard budget and fd count.
+  static void Account(Shard& shard, const CachedFile& file, bool add);
+
+  // Removes the entry for path if it is still the given file.
+  void Erase(Shard& shard, const std::string& path, const CachedFile* file);
+
+  std::array<Shard, kShardCount> shards_;
+  size_t shard_budget_;               // Memory budget per shard
+  size_t max_entry_size_;             // Largest cacheable file
+  size_t sendfile_threshold_;         // Smallest unmapped file, 0=none
+  std::chrono::nanoseconds revalidate_interval_;
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_HTTP_FILE_CACHE_H_
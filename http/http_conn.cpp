@@ -4,14 +4,18 @@
 #include "http_conn.h"
 
 #include <mysql/mysql.h>
+#include <algorithm>
+#include <cinttypes>
 #include <cstdarg>
 #include <cstring>
-#include <mutex>
+#include <ctime>
 #include <iostream>
 namespace tinywebserver {
 
 // HTTP response status information
 const char* kOk200Title = "OK";
+const char* kPartial206Title = "Partial Content";
+const char* kNotModified304Title = "Not Modified";
 const char* kError400Title = "Bad Request";
 const char* kError400Form =
     "Your request has bad syntax or is inherently impossible to satisfy.\n";
@@ -21,50 +25,82 @@ const char* kError403Form =
 const char* kError404Title = "Not Found";
 const char* kError404Form =
     "The requested file was not found on this server.\n";
+const char* kError416Title = "Range Not Satisfiable";
+const char* kError416Form =
+    "The requested range is not satisfiable for this file.\n";
 const char* kError500Title = "Internal Error";
 const char* kError500Form =
     "There was an unusual problem serving the request file.\n";
 
-std::mutex users_mutex;
-std::map<std::string, std::string> users;
+namespace {
 
-void HttpConnection::initmysql_result(ConnectionPool* connPool) {
-  // 先从连接池中取一个连接
-  MYSQL* mysql = nullptr;
-  ConnectionRAII mysqlcon(&mysql, connPool);
+// multipart/byteranges 分隔符的序号，保证相邻响应的分隔符不同
+std::atomic<uint64_t> g_boundary_seq{0};
 
-  if (mysql == nullptr) {
-    LOG_ERROR("%s", "MySQL connection retrieval failed");
-    return;
-  }
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
 
-  // 在 user 表中检索 username，passwd 数据
-  if (mysql_query(mysql, "SELECT username,passwd FROM user")) {
-    LOG_ERROR("SELECT error: %s", mysql_error(mysql));
-    return;
+// 解析 text 开头的十进制数并将其从 text 中移除，溢出时返回 false
+bool ParseNumber(std::string_view* text, size_t* value) {
+  size_t result = 0;
+  size_t i = 0;
+  if (text->empty() || !IsDigit((*text)[0])) return false;
+  for (; i < text->size() && IsDigit((*text)[i]); ++i) {
+    size_t digit = static_cast<size_t>((*text)[i] - '0');
+    if (result > (SIZE_MAX - digit) / 10) return false;
+    result = result * 10 + digit;
   }
+  text->remove_prefix(i);
+  *value = result;
+  return true;
+}
 
-  // 从表中检索完整的结果集
-  MYSQL_RES* result = mysql_store_result(mysql);
-  if (result == nullptr) {
-    if (mysql_field_count(mysql) != 0) {
-      LOG_ERROR("mysql_store_result error: %s", mysql_error(mysql));
-    }
-    return;
-  }
+// 去掉开头的空白和指定分隔符
+void SkipSeparators(std::string_view* text, const char* separators) {
+  size_t pos = text->find_first_not_of(separators);
+  text->remove_prefix(pos == std::string_view::npos ? text->size() : pos);
+}
 
-  std::lock_guard<std::mutex> lock(users_mutex);
-  users.clear();
+// 文本类静态文件的压缩方式 (0=关闭, 1=仅预压缩文件, 2=预压缩文件+内存压缩副本)
+int g_compression_mode = 2;
 
-  // 从结果集中获取下一行，将对应的用户名和密码，存入 map 中
-  while (MYSQL_ROW row = mysql_fetch_row(result)) {
-    if (row[0] == nullptr || row[1] == nullptr) {
-      continue;
+// 按 URL 前缀配置的 Cache-Control，启动时设置，之后只读
+std::vector<std::pair<std::string, std::string>> g_cache_control_rules;
+
+// 取最长匹配前缀的 Cache-Control 值，没有匹配时返回 nullptr
+const char* FindCacheControl(std::string_view url) {
+  for (const auto& rule : g_cache_control_rules) {
+    if (url.compare(0, rule.first.size(), rule.first) == 0) {
+      return rule.second.c_str();
     }
-    users[std::string(row[0])] = std::string(row[1]);
   }
+  return nullptr;
+}
+
+// If-None-Match 使用弱比较：忽略 W/ 前缀，列表中任一标签相同即匹配
+bool ETagListMatches(std::string_view list, std::string_view etag) {
+  while (true) {
+    SkipSeparators(&list, " \t,");
+    if (list.empty()) return false;
+    if (list[0] == '*') return true;
+    if (list.compare(0, 2, "W/") == 0) list.remove_prefix(2);
+    std::string_view tag = list.substr(0, list.find_first_of(" \t,"));
+    if (tag == etag) return true;
+    list.remove_prefix(tag.size());
+  }
+}
+
+}  // namespace
 
-  mysql_free_result(result);
+void HttpConnection::SetCompression(int mode) { g_compression_mode = mode; }
+
+void HttpConnection::SetCacheControlRules(
+    std::vector<std::pair<std::string, std::string>> rules) {
+  // 按前缀长度降序排列，查找时第一个匹配即为最长前缀
+  std::stable_sort(rules.begin(), rules.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.first.size() > b.first.size();
+                   });
+  g_cache_control_rules = std::move(rules);
 }
 
 // 对文件描述符设置非阻塞
@@ -109,8 +145,7 @@ void ModifyFd(int epollfd, int fd, int ev, int trigger_mode) {
   epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &event);
 }
 
-int HttpConnection::m_user_count = 0;
-int HttpConnection::m_epollfd = -1;
+std::atomic<int> HttpConnection::m_user_count{0};
 
 HttpConnection::~HttpConnection() {
   // Destructor implementation
@@ -120,122 +155,170 @@ HttpConnection::~HttpConnection() {
 void HttpConnection::close_conn(bool real_close) {
   if (real_close && (sockfd_ != -1)) {
     printf("close %d\n", sockfd_);
-    RemoveFd(m_epollfd, sockfd_);
+    RemoveFd(epollfd_, sockfd_);
     sockfd_ = -1;
     m_user_count--;
   }
 }
 
 // 初始化连接,外部调用初始化套接字地址
-void HttpConnection::init(int sockfd, const sockaddr_in& addr, char* root,
-                          int trigger_mode, int close_log,
-                          const std::string& user, const std::string& passwd,
-                          const std::string& sqlname) {
+void HttpConnection::init(int sockfd, const sockaddr_in& addr, int epollfd,
+                          CompletionQueue* completion_queue, char* root,
+                          int trigger_mode) {
   sockfd_ = sockfd;
+  epollfd_ = epollfd;
+  completion_queue_ = completion_queue;
   address_ = addr;
 
-  AddFd(m_epollfd, sockfd, true, trigger_mode);
+  AddFd(epollfd_, sockfd, true, trigger_mode);
   m_user_count++;
 
   // 当浏览器出现连接重置时，可能是网站根目录出错或http响应格式出错或者访问的文件中内容完全为空
   doc_root_ = root;
   trigger_mode_ = trigger_mode;
-  close_log_ = close_log;
-
-  sql_user_.assign(user.begin(), user.end());
-  sql_user_.push_back('\0');
-  sql_passwd_.assign(passwd.begin(), passwd.end());
-  sql_passwd_.push_back('\0');
-  sql_name_.assign(sqlname.begin(), sqlname.end());
-  sql_name_.push_back('\0');
 
   init();
 }
 
 // 初始化新接受的连接
-// check_state默认为分析请求行状态
 void HttpConnection::init() {
-  mysql = NULL;
-  bytes_to_send_ = 0;
-  bytes_have_send_ = 0;
-  check_state_ = CheckState::kRequestLine;
+  parser_.Reset();
   linger_ = false;
-  method_ = Method::kGet;
-  url_ = 0;
-  version_ = 0;
-  content_length_ = 0;
-  host_ = 0;
-  start_line_ = 0;
-  checked_idx_ = 0;
   read_idx_ = 0;
-  write_idx_ = 0;
+  request_start_ = 0;
+  deferred_ = HttpCode::kNoRequest;
+  buffered_request_ = false;
+  ResetRequest();
+  // 上一个连接可能在响应中途被关闭，这里释放它遗留的缓冲区和文件引用，
+  // 缓冲区在收到数据时再从内存池获取
+  read_buf_.Reset();
+  ResetResponses();
+  ReleaseFile();
+
+  // 文档根目录只在这里写入一次，每个请求只需把路径接在它后面
+  doc_root_len_ =
+      std::min(strlen(doc_root_), static_cast<size_t>(kFileNameLen) - 1);
+  memcpy(&real_file_[0], doc_root_, doc_root_len_);
+  real_file_[doc_root_len_] = '\0';
+}
+
+// 清空单个请求的解析结果，只重置字段与视图，不清零任何缓冲区；
+// 连接级的缓冲区与排队的响应不受影响
+void HttpConnection::ResetRequest() {
+  method_ = Method::kGet;
+  url_ = std::string_view();
+  host_ = std::string_view();
   cgi_ = 0;
-  m_state = 0;
-  timer_flag = 0;
-  improv = 0;
-
-  read_buf_.resize(kReadBufferSize);
-  std::memset(&read_buf_[0], '\0', kReadBufferSize);
-  write_buf_.resize(kWriteBufferSize);
-  std::memset(&write_buf_[0], '\0', kWriteBufferSize);
-  real_file_.resize(kFileNameLen);
-  std::memset(&real_file_[0], '\0', kFileNameLen);
-}
-
-// 从状态机，用于分析出一行内容
-// 返回值为行的读取状态，有LineStatus::kOk,LineStatus::kBad,LineStatus::kOpen
-HttpConnection::LineStatus HttpConnection::ParseLine() {
-  char temp;
-  for (; checked_idx_ < read_idx_; ++checked_idx_) {
-    temp = read_buf_[checked_idx_];
-    if (temp == '\r') {
-      if ((checked_idx_ + 1) == read_idx_)
-        return LineStatus::kOpen;
-      else if (read_buf_[checked_idx_ + 1] == '\n') {
-        read_buf_[checked_idx_++] = '\0';
-        read_buf_[checked_idx_++] = '\0';
-        return LineStatus::kOk;
-      }
-      return LineStatus::kBad;
-    } else if (temp == '\n') {
-      if (checked_idx_ > 1 && read_buf_[checked_idx_ - 1] == '\r') {
-        read_buf_[checked_idx_ - 1] = '\0';
-        read_buf_[checked_idx_++] = '\0';
-        return LineStatus::kOk;
-      }
-      return LineStatus::kBad;
-    }
+  body_ = std::string_view();
+  range_ = std::string_view();
+  if_range_ = std::string_view();
+  if_none_match_ = std::string_view();
+  if_modified_since_ = std::string_view();
+  accept_encoding_ = std::string_view();
+  content_encoding_ = ContentEncoding::kIdentity;
+  content_type_ = kDefaultMimeType;
+  vary_encoding_ = false;
+  range_count_ = 0;
+  file_.reset();
+  file_address_ = nullptr;
+}
+
+// 当前请求的响应已排入发送队列，跳到下一个流水线请求的起点
+void HttpConnection::FinishRequest() {
+  if (AccessLog::IsEnabled()) {
+    LogAccess();
   }
-  return LineStatus::kOpen;
+  request_start_ += parser_.message_length();
+  parser_.Reset();
+  ResetRequest();
+}
+
+// 按采样率把请求交给访问日志，字段在写入线程缓冲区时复制
+void HttpConnection::LogAccess() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  if (AccessLog::Sample()) {
+    AccessLog::Entry entry;
+    entry.time = now;
+    entry.latency_us =
+        (now.tv_sec - request_begin_.tv_sec) * 1000000 +
+        (now.tv_nsec - request_begin_.tv_nsec) / 1000;
+    entry.bytes = static_cast<uint64_t>(bytes_to_send_ - response_begin_);
+    entry.address = address_.sin_addr.s_addr;
+    entry.port = address_.sin_port;
+    entry.status = status_;
+    entry.method = parser_.method();
+    entry.target = parser_.target();
+    entry.version = parser_.version();
+    entry.referer = parser_.FindHeader("Referer");
+    entry.user_agent = parser_.FindHeader("User-Agent");
+    AccessLog::GetInstance()->Write(entry);
+  }
+  // 已在读缓冲区中的下一个流水线请求从此刻开始计时
+  request_begin_ = now;
+}
+
+// 把尚未处理的流水线数据移到读缓冲区开头，并检查其中是否已有完整请求
+void HttpConnection::CompactReadBuffer() {
+  size_t leftover = read_idx_ - request_start_;
+  if (leftover == 0) {
+    // 连接空闲，读缓冲区还给内存池
+    read_buf_.Reset();
+  } else if (request_start_ > 0) {
+    memmove(read_buf_.data(), read_buf_.data() + request_start_, leftover);
+  }
+  read_idx_ = leftover;
+  request_start_ = 0;
+  buffered_request_ =
+      leftover > 0 && parser_.Parse(read_buf_.data(), read_idx_) !=
+                          HttpRequestParser::Status::kIncomplete;
+}
+
+// 首次读取时从内存池取一块；读满而请求仍不完整时加倍扩容，解析器只保存
+// 偏移量，搬移数据不影响已解析的部分
+bool HttpConnection::ReserveReadSpace() {
+  if (!read_buf_) {
+    read_buf_.Allocate(BufferPool::kChunkSize);
+    return true;
+  }
+  if (read_idx_ < read_buf_.capacity()) {
+    return true;
+  }
+  if (read_buf_.capacity() >= kMaxReadBufferSize) {
+    return false;
+  }
+  read_buf_.Grow(read_buf_.capacity() * 2, read_idx_);
+  return true;
 }
 
 // 循环读取客户数据，直到无数据可读或对方关闭连接
 // 非阻塞ET工作模式下，需要一次性将数据读完
 bool HttpConnection::read_once() {
-  if (read_idx_ >= kReadBufferSize) {
+  if (!ReserveReadSpace()) {
     return false;
   }
+  // 没有未处理完的请求时，新请求从这次读取开始计时
+  if (read_idx_ == request_start_ && AccessLog::IsEnabled()) {
+    clock_gettime(CLOCK_REALTIME, &request_begin_);
+  }
   int bytes_read = 0;
 
   // LT读取数据
   if (0 == trigger_mode_) {
-    bytes_read = recv(sockfd_, &read_buf_[read_idx_],
-                      kReadBufferSize - read_idx_, 0);
-    read_idx_ += bytes_read;
-
-    
-    
+    bytes_read = recv(sockfd_, read_buf_.data() + read_idx_,
+                      read_buf_.capacity() - read_idx_, 0);
     if (bytes_read <= 0) {
       return false;
     }
+    read_idx_ += bytes_read;
 
     return true;
   }
   // ET读数据
   else {
     while (true) {
-      bytes_read = recv(sockfd_, &read_buf_[read_idx_],
-                        kReadBufferSize - read_idx_, 0);
+      bytes_read = recv(sockfd_, read_buf_.data() + read_idx_,
+                        read_buf_.capacity() - read_idx_, 0);
       if (bytes_read == -1) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) break;
         return false;
@@ -243,7 +326,7 @@ bool HttpConnection::read_once() {
         return false;
       }
       read_idx_ += bytes_read;
-      if (read_idx_ >= kReadBufferSize) {
+      if (!ReserveReadSpace()) {
         break;
       }
     }
@@ -251,303 +334,617 @@ bool HttpConnection::read_once() {
   }
 }
 
-// 解析http请求行，获得请求方法，目标url及http版本号
-HttpConnection::HttpCode HttpConnection::ParseRequestLine(char* text) {
-  url_ = strpbrk(text, " \t");
-  if (!url_) {
-    return HttpCode::kBadRequest;
-  }
-  *url_++ = '\0';
-  char* method = text;
-  if (strcasecmp(method, "GET") == 0)
+// 校验请求行，获得请求方法和目标url
+HttpConnection::HttpCode HttpConnection::ParseRequestLine() {
+  std::string_view method = parser_.method();
+  if (method == "GET") {
     method_ = Method::kGet;
-  else if (strcasecmp(method, "POST") == 0) {
+  } else if (method == "POST") {
     method_ = Method::kPost;
     cgi_ = 1;
-  } else
+  } else {
     return HttpCode::kBadRequest;
-  url_ += strspn(url_, " \t");
-  version_ = strpbrk(url_, " \t");
-  if (!version_) return HttpCode::kBadRequest;
-  *version_++ = '\0';
-  version_ += strspn(version_, " \t");
-  if (strcasecmp(version_, "HTTP/1.1") != 0) return HttpCode::kBadRequest;
-  if (strncasecmp(url_, "http://", 7) == 0) {
-    url_ += 7;
-    url_ = strchr(url_, '/');
   }
-
-  if (strncasecmp(url_, "https://", 8) == 0) {
-    url_ += 8;
-    url_ = strchr(url_, '/');
-  }
-
-  if (!url_ || url_[0] != '/') return HttpCode::kBadRequest;
-  // 当url为/时，显示判断界面
-  if (strlen(url_) == 1) strcat(url_, "judge.html");
-  check_state_ = CheckState::kHeader;
-  return HttpCode::kNoRequest;
-}
-
-// 解析http请求的一个头部信息
-HttpConnection::HttpCode HttpConnection::ParseHeaders(char* text) {
-  if (text[0] == '\0') {
-    if (content_length_ != 0) {
-      check_state_ = CheckState::kContent;
-      return HttpCode::kNoRequest;
-    }
-    return HttpCode::kGetRequest;
-  } else if (strncasecmp(text, "Connection:", 11) == 0) {
-    text += 11;
-    text += strspn(text, " \t");
-    if (strcasecmp(text, "keep-alive") == 0) {
-      linger_ = true;
+  if (parser_.version() != "HTTP/1.1") return HttpCode::kBadRequest;
+
+  // 绝对形式的目标去掉协议和主机部分
+  url_ = parser_.target();
+  for (std::string_view scheme : {"http://", "https://"}) {
+    if (url_.size() >= scheme.size() &&
+        strncasecmp(url_.data(), scheme.data(), scheme.size()) == 0) {
+      url_.remove_prefix(scheme.size());
+      size_t slash = url_.find('/');
+      url_.remove_prefix(slash == std::string_view::npos ? url_.size() : slash);
+      break;
     }
-  } else if (strncasecmp(text, "Content-length:", 15) == 0) {
-    text += 15;
-    text += strspn(text, " \t");
-    content_length_ = atol(text);
-  } else if (strncasecmp(text, "Host:", 5) == 0) {
-    text += 5;
-    text += strspn(text, " \t");
-    host_ = text;
-  } else {
-    LOG_INFO("oop!unknow header: %s", text);
-  }
-  return HttpCode::kNoRequest;
-}
-
-// 判断http请求是否被完整读入
-HttpConnection::HttpCode HttpConnection::ParseContent(char* text) {
-  if (read_idx_ >= (content_length_ + checked_idx_)) {
-    text[content_length_] = '\0';
-    // POST请求中最后为输入的用户名和密码
-    string_ = text;
-    return HttpCode::kGetRequest;
   }
+  if (url_.empty() || url_[0] != '/') return HttpCode::kBadRequest;
+  // 当url为/时，显示判断界面
+  if (url_.size() == 1) url_ = "/judge.html";
   return HttpCode::kNoRequest;
 }
 
-HttpConnection::HttpCode HttpConnection::ProcessRead() {
-  LineStatus line_status = LineStatus::kOk;
-  HttpCode ret = HttpCode::kNoRequest;
-  char* text = 0;
-
-  while ((check_state_ == CheckState::kContent &&
-          line_status == LineStatus::kOk) ||
-         ((line_status = ParseLine()) == LineStatus::kOk)) {
-    text = GetLine();
-    start_line_ = checked_idx_;
-    LOG_INFO("%s", text);
-    switch (check_state_) {
-      case CheckState::kRequestLine: {
-        ret = ParseRequestLine(text);
-        if (ret == HttpCode::kBadRequest) return HttpCode::kBadRequest;
+// 取出服务端关心的头部，其余头部直接忽略
+void HttpConnection::ParseHeaders() {
+  for (int i = 0; i < parser_.header_count(); ++i) {
+    HttpRequestParser::Header header = parser_.header(i);
+    std::string_view name = header.name;
+    // 按名称长度分派，每个头部至多做一次不区分大小写的比较
+    auto is = [&name](std::string_view expected) {
+      return name.size() == expected.size() &&
+             strncasecmp(name.data(), expected.data(), name.size()) == 0;
+    };
+    switch (name.size()) {
+      case 4:
+        if (is("Host")) host_ = header.value;
         break;
-      }
-      case CheckState::kHeader: {
-        ret = ParseHeaders(text);
-        if (ret == HttpCode::kBadRequest)
-          return HttpCode::kBadRequest;
-        else if (ret == HttpCode::kGetRequest) {
-          return DoRequest();
+      case 5:
+        if (is("Range")) range_ = header.value;
+        break;
+      case 8:
+        if (is("If-Range")) if_range_ = header.value;
+        break;
+      case 10:
+        if (is("Connection") && header.value.size() == 10 &&
+            strncasecmp(header.value.data(), "keep-alive", 10) == 0) {
+          linger_ = true;
         }
         break;
-      }
-      case CheckState::kContent: {
-        ret = ParseContent(text);
-        if (ret == HttpCode::kGetRequest) return DoRequest();
-        line_status = LineStatus::kOpen;
+      case 13:
+        if (is("If-None-Match")) if_none_match_ = header.value;
+        break;
+      case 15:
+        if (is("Accept-Encoding")) accept_encoding_ = header.value;
+        break;
+      case 17:
+        if (is("If-Modified-Since")) if_modified_since_ = header.value;
         break;
-      }
       default:
-        return HttpCode::kInternalError;
+        break;
     }
   }
-  return HttpCode::kNoRequest;
+}
+
+// 请求行、头部和请求体全部到达后才开始处理，解析过程不修改读缓冲区
+HttpConnection::HttpCode HttpConnection::ProcessRead() {
+  switch (parser_.Parse(read_buf_.data() + request_start_,
+                        read_idx_ - request_start_)) {
+    case HttpRequestParser::Status::kIncomplete:
+      return HttpCode::kNoRequest;
+    case HttpRequestParser::Status::kError:
+      // 请求边界已无法确定，后续的流水线数据不能再解析，响应后关闭连接
+      linger_ = false;
+      return HttpCode::kBadRequest;
+    case HttpRequestParser::Status::kComplete:
+      break;
+  }
+  std::string_view method = parser_.method();
+  std::string_view target = parser_.target();
+  LOG_DEBUG("%.*s %.*s", method, target);
+
+  linger_ = false;
+  ParseHeaders();
+  HttpCode ret = ParseRequestLine();
+  if (ret == HttpCode::kBadRequest) return ret;
+  // POST请求中最后为输入的用户名和密码
+  body_ = parser_.body();
+  return DoRequest();
 }
 
 HttpConnection::HttpCode HttpConnection::DoRequest() {
-  strcpy(&real_file_[0], doc_root_);
-  int len = strlen(doc_root_);
-  const char* p = strrchr(url_, '/');
+  const size_t len = doc_root_len_;
+  // 把请求路径拼接到文档根目录之后
+  auto set_path = [this, len](std::string_view path) {
+    size_t n = std::min(path.size(), static_cast<size_t>(kFileNameLen) - len - 1);
+    memcpy(&real_file_[len], path.data(), n);
+    real_file_[len + n] = '\0';
+  };
+  size_t slash = url_.rfind('/');
+  char route = slash + 1 < url_.size() ? url_[slash + 1] : '\0';
 
   // 处理cgi
-  if (cgi_ == 1 && (*(p + 1) == '2' || *(p + 1) == '3')) {
-    // 根据标志判断是登录检测还是注册检测
-    char flag = url_[1];
-
-    char* m_url_real = (char*)malloc(sizeof(char) * 200);
-    strcpy(m_url_real, "/");
-    strcat(m_url_real, url_ + 2);
-    strncpy(&real_file_[len], m_url_real, kFileNameLen - len - 1);
-    free(m_url_real);
+  if (cgi_ == 1 && (route == '2' || route == '3')) {
+    set_path("/" + std::string(url_.substr(std::min<size_t>(2, url_.size()))));
 
     // 将用户名和密码提取出来
-    // user=123&passwd=123
-    char name[100], password[100];
-    int i;
-    for (i = 5; string_[i] != '&'; ++i) name[i - 5] = string_[i];
-    name[i - 5] = '\0';
-
-    int j = 0;
-    for (i = i + 10; string_[i] != '\0'; ++i, ++j) password[j] = string_[i];
-    password[j] = '\0';
-
-    if (*(p + 1) == '3') {
-      // 如果是注册，先检测数据库中是否有重名的
-      // 没有重名的，进行增加数据
-      char* sql_insert = (char*)malloc(sizeof(char) * 200);
-      strcpy(sql_insert, "INSERT INTO user(username, passwd) VALUES(");
-      strcat(sql_insert, "'");
-      strcat(sql_insert, name);
-      strcat(sql_insert, "', '");
-      strcat(sql_insert, password);
-      strcat(sql_insert, "')");
-
-      if (users.find(name) == users.end()) {
-        std::lock_guard<std::mutex> lock(users_mutex);
-        int res = mysql_query(mysql, sql_insert);
-        users.insert(std::pair<std::string, std::string>(name, password));
-
-        if (!res)
-          strcpy(url_, "/log.html");
-        else
-          strcpy(url_, "/registerError.html");
-      } else
-        strcpy(url_, "/registerError.html");
+    // user=123&password=123
+    size_t amp = std::min(body_.find('&'), body_.size());
+    size_t name_begin = std::min<size_t>(5, amp);
+    std::string name(body_.substr(name_begin, amp - name_begin));
+    std::string password(body_.substr(std::min(amp + 10, body_.size())));
+
+    UserStore* store = UserStore::GetInstance();
+    if (route == '3') {
+      // 如果是注册，用户名未被占用时以预处理语句写库；
+      // 数据库连接只在这里按需获取，静态文件请求不会等待连接池
+      if (store->Register(name, password))
+        url_ = "/log.html";
+      else
+        url_ = "/registerError.html";
     }
-    // 如果是登录，直接判断
-    // 若浏览器端输入的用户名和密码在表中可以查找到，返回1，否则返回0
-    else if (*(p + 1) == '2') {
-      if (users.find(name) != users.end() && users[name] == password)
-        strcpy(url_, "/welcome.html");
+    // 如果是登录，在内存用户表中校验，只有未知用户才查询数据库
+    else if (route == '2') {
+      if (store->Login(name, password))
+        url_ = "/welcome.html";
       else
-        strcpy(url_, "/logError.html");
+        url_ = "/logError.html";
     }
   }
 
-  if (*(p + 1) == '0') {
-    char* m_url_real = (char*)malloc(sizeof(char) * 200);
-    strcpy(m_url_real, "/register.html");
-    strncpy(&real_file_[len], m_url_real, strlen(m_url_real));
-
-    free(m_url_real);
-  } else if (*(p + 1) == '1') {
-    char* m_url_real = (char*)malloc(sizeof(char) * 200);
-    strcpy(m_url_real, "/log.html");
-    strncpy(&real_file_[len], m_url_real, strlen(m_url_real));
+  if (route == '0') {
+    set_path("/register.html");
+  } else if (route == '1') {
+    set_path("/log.html");
+  } else if (route == '5') {
+    set_path("/picture.html");
+  } else if (route == '6') {
+    set_path("/video.html");
+  } else if (route == '7') {
+    set_path("/fans.html");
+  } else {
+    set_path(url_);
+  }
 
-    free(m_url_real);
-  } else if (*(p + 1) == '5') {
-    char* m_url_real = (char*)malloc(sizeof(char) * 200);
-    strcpy(m_url_real, "/picture.html");
-    strncpy(&real_file_[len], m_url_real, strlen(m_url_real));
+  // 类型按原始文件名确定，发送 .br/.gz 同名文件时也保持不变
+  content_type_ = MimeTypeFor(&real_file_[0]);
 
-    free(m_url_real);
-  } else if (*(p + 1) == '6') {
-    char* m_url_real = (char*)malloc(sizeof(char) * 200);
-    strcpy(m_url_real, "/video.html");
-    strncpy(&real_file_[len], m_url_real, strlen(m_url_real));
+  // 协商内容编码：优先发送预压缩的 .br/.gz 同名文件，其次是缓存的压缩副本
+  HttpCode ret = NegotiateEncoding();
+  if (ret != HttpCode::kNoRequest) {
+    return ret;
+  }
+  ret = AcquireFile(&real_file_[0], ContentEncoding::kIdentity);
+  return ret == HttpCode::kFileRequest ? ResolveRange() : ret;
+}
 
-    free(m_url_real);
-  } else if (*(p + 1) == '7') {
-    char* m_url_real = (char*)malloc(sizeof(char) * 200);
-    strcpy(m_url_real, "/fans.html");
-    strncpy(&real_file_[len], m_url_real, strlen(m_url_real));
+// 文本类文件按 Accept-Encoding 选择编码，返回 kNoRequest 表示发送原始内容
+HttpConnection::HttpCode HttpConnection::NegotiateEncoding() {
+  const char* path = &real_file_[0];
+  if (g_compression_mode == 0 || method_ != Method::kGet ||
+      !IsCompressible(path)) {
+    return HttpCode::kNoRequest;
+  }
+  // 响应内容随 Accept-Encoding 变化，无论最终是否压缩都要告知中间缓存
+  vary_encoding_ = true;
+  // Range 只作用于原始内容
+  if (accept_encoding_.empty() || !range_.empty()) {
+    return HttpCode::kNoRequest;
+  }
 
-    free(m_url_real);
-  } else
-    strncpy(&real_file_[len], url_, kFileNameLen - len - 1);
+  static constexpr ContentEncoding kPreferred[] = {ContentEncoding::kBrotli,
+                                                   ContentEncoding::kGzip};
+  for (ContentEncoding encoding : kPreferred) {
+    if (!AcceptsEncoding(accept_encoding_, encoding)) continue;
+    if (!FileCache::GetInstance()->HasSibling(path, encoding)) {
+      continue;
+    }
+    std::string sibling = std::string(path) + EncodingSuffix(encoding);
+    HttpCode ret = AcquireFile(sibling, ContentEncoding::kIdentity);
+    if (ret == HttpCode::kFileRequest || ret == HttpCode::kNotModified) {
+      content_encoding_ = encoding;
+      return ret;
+    }
+  }
 
-  if (stat(&real_file_[0], &file_stat_) < 0) return HttpCode::kNoResource;
+  if (g_compression_mode < 2) {
+    return HttpCode::kNoRequest;
+  }
+  for (ContentEncoding encoding : kPreferred) {
+    if (!CanCompress(encoding) || !AcceptsEncoding(accept_encoding_, encoding)) {
+      continue;
+    }
+    HttpCode ret = AcquireFile(path, encoding);
+    if (ret == HttpCode::kFileRequest || ret == HttpCode::kNotModified) {
+      content_encoding_ = encoding;
+      return ret;
+    }
+    // 文件过大或过小、无法缓存压缩副本时发送原始内容
+    break;
+  }
+  return HttpCode::kNoRequest;
+}
 
-  if (!(file_stat_.st_mode & S_IROTH)) return HttpCode::kForbiddenRequest;
+// 取要发送的文件，compress 不为 identity 时取缓存的压缩副本
+HttpConnection::HttpCode HttpConnection::AcquireFile(
+    const std::string& path, ContentEncoding compress) {
+  FileCache* cache = FileCache::GetInstance();
+
+  // 条件请求先只取元数据，客户端缓存仍有效时直接返回 304，不打开也不映射文件
+  struct stat st;
+  if (method_ == Method::kGet &&
+      (!if_none_match_.empty() || !if_modified_since_.empty()) &&
+      cache->Stat(path, &st) == FileCache::Status::kOk) {
+    FormatETag(st, not_modified_etag_, sizeof(not_modified_etag_),
+               compress == ContentEncoding::kIdentity ? ""
+                                                      : EncodingToken(compress));
+    not_modified_mtime_ = st.st_mtime;
+    if (NotModified(not_modified_etag_, not_modified_mtime_)) {
+      return HttpCode::kNotModified;
+    }
+  }
 
-  if (S_ISDIR(file_stat_.st_mode)) return HttpCode::kBadRequest;
+  // 文件的打开与映射由共享的文件缓存完成，命中时无需任何系统调用
+  FileCache::Status status =
+      compress == ContentEncoding::kIdentity
+          ? cache->Acquire(path, &file_)
+          : cache->AcquireCompressed(path, compress, &file_);
+  switch (status) {
+    case FileCache::Status::kOk:
+      break;
+    case FileCache::Status::kNotFound:
+      return HttpCode::kNoResource;
+    case FileCache::Status::kForbidden:
+      return HttpCode::kForbiddenRequest;
+    case FileCache::Status::kDirectory:
+      return HttpCode::kBadRequest;
+    case FileCache::Status::kError:
+      return HttpCode::kInternalError;
+  }
 
-  int fd = open(&real_file_[0], O_RDONLY);
-  file_address_ =
-      (char*)mmap(0, file_stat_.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-  close(fd);
+  file_address_ = file_->data();
   return HttpCode::kFileRequest;
 }
 
-void HttpConnection::Unmap() {
+// 按 RFC 7233 解析 Range 头；语法错误或区间过多时忽略该头，返回完整文件
+HttpConnection::HttpCode HttpConnection::ResolveRange() {
+  range_count_ = 0;
+  size_t size = file_->size();
+  if (range_.empty() || method_ != Method::kGet || size == 0) {
+    return HttpCode::kFileRequest;
+  }
+  // If-Range 不匹配说明客户端缓存的内容已过期，应返回完整的新内容
+  if (!if_range_.empty() && !IfRangeMatches()) {
+    return HttpCode::kFileRequest;
+  }
+  if (range_.size() < 6 || strncasecmp(range_.data(), "bytes=", 6) != 0) {
+    return HttpCode::kFileRequest;
+  }
+
+  std::string_view p = range_.substr(6);
+  int specs = 0;
+  while (true) {
+    SkipSeparators(&p, " \t,");
+    if (p.empty()) break;
+    // 限制区间个数，防止大量重叠区间放大响应
+    if (++specs > kMaxRanges) return HttpCode::kFileRequest;
+
+    size_t first = 0;
+    size_t last = size - 1;
+    if (p[0] == '-') {
+      // 后缀区间 -N 表示最后 N 个字节
+      p.remove_prefix(1);
+      size_t suffix = 0;
+      if (!ParseNumber(&p, &suffix)) return HttpCode::kFileRequest;
+      if (suffix == 0) {
+        first = size;  // 不可满足
+      } else if (suffix < size) {
+        first = size - suffix;
+      }
+    } else {
+      if (!ParseNumber(&p, &first) || p.empty() || p[0] != '-') {
+        return HttpCode::kFileRequest;
+      }
+      p.remove_prefix(1);
+      if (!p.empty() && IsDigit(p[0])) {
+        size_t end = 0;
+        if (!ParseNumber(&p, &end) || end < first) {
+          return HttpCode::kFileRequest;
+        }
+        if (end < last) last = end;
+      }
+    }
+    SkipSeparators(&p, " \t");
+    if (!p.empty() && p[0] != ',') return HttpCode::kFileRequest;
+
+    // 起点越过文件末尾的区间不可满足，直接跳过
+    if (first < size) {
+      ranges_[range_count_++] = ByteRange{first, last};
+    }
+  }
+
+  if (range_count_ == 0) {
+    return specs > 0 ? HttpCode::kRangeNotSatisfiable : HttpCode::kFileRequest;
+  }
+  return HttpCode::kPartialContent;
+}
+
+// If-Range 为实体标签或日期，要求强匹配：弱标签永不匹配，日期须与
+// Last-Modified 完全一致
+bool HttpConnection::IfRangeMatches() const {
+  if (if_range_[0] == '"') {
+    return if_range_ == file_->etag();
+  }
+  if (if_range_.compare(0, 2, "W/") == 0) {
+    return false;
+  }
+  return if_range_ == file_->last_modified();
+}
+
+// RFC 7232：存在 If-None-Match 时忽略 If-Modified-Since
+bool HttpConnection::NotModified(const char* etag, time_t mtime) const {
+  if (!if_none_match_.empty()) {
+    return ETagListMatches(if_none_match_, etag);
+  }
+
+  // strptime 需要以 '\0' 结尾的字符串，日期很短，复制到栈上即可
+  char date[64];
+  if (if_modified_since_.size() >= sizeof(date)) {
+    return false;
+  }
+  memcpy(date, if_modified_since_.data(), if_modified_since_.size());
+  date[if_modified_since_.size()] = '\0';
+  struct tm tm;
+  std::memset(&tm, 0, sizeof(tm));
+  const char* end = strptime(date, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  if (!end || *end != '\0') {
+    return false;
+  }
+  return mtime <= timegm(&tm);
+}
+
+void HttpConnection::ReleaseFile() {
+  file_.reset();
+  file_address_ = nullptr;
+  for (int i = 0; i < held_count_; ++i) {
+    held_files_[i].reset();
+  }
+  held_count_ = 0;
+}
+
+// 跨越写缓冲块边界的字节拆成两段
+void HttpConnection::AddBufferSegment(int begin, int end) {
+  const int chunk_size = static_cast<int>(BufferPool::kChunkSize);
+  while (begin < end) {
+    int stop = std::min(end, (begin / chunk_size + 1) * chunk_size);
+    char* base = write_chunks_[begin / chunk_size].data() + begin % chunk_size;
+    size_t length = static_cast<size_t>(stop - begin);
+    bytes_to_send_ += stop - begin;
+    begin = stop;
+    // 与上一段在同一块中相邻时直接合并，如连续的 304 响应
+    if (iov_count_ > iov_index_ && segment_file_[iov_count_ - 1] < 0) {
+      struct iovec& last = iov_[iov_count_ - 1];
+      if (static_cast<char*>(last.iov_base) + last.iov_len == base) {
+        last.iov_len += length;
+        continue;
+      }
+    }
+    if (iov_count_ == kMaxIovecs) {
+      write_overflow_ = true;
+      return;
+    }
+    segment_file_[iov_count_] = -1;
+    iov_[iov_count_].iov_base = base;
+    iov_[iov_count_].iov_len = length;
+    ++iov_count_;
+  }
+}
+
+void HttpConnection::AddFileSegment(size_t offset, size_t length) {
+  // 每个排队的响应各自持有所发送文件的引用
+  bool new_file = held_count_ == 0 || held_files_[held_count_ - 1] != file_;
+  if (iov_count_ == kMaxIovecs || (new_file && held_count_ == kMaxHeldFiles)) {
+    write_overflow_ = true;
+    return;
+  }
+  if (new_file) {
+    held_files_[held_count_++] = file_;
+  }
+  segment_file_[iov_count_] = static_cast<int8_t>(held_count_ - 1);
   if (file_address_) {
-    munmap(file_address_, file_stat_.st_size);
-    file_address_ = 0;
+    iov_[iov_count_].iov_base = const_cast<char*>(file_address_ + offset);
+  } else {
+    iov_[iov_count_].iov_base = nullptr;
+    file_offset_[iov_count_] = static_cast<off_t>(offset);
   }
+  iov_[iov_count_].iov_len = length;
+  ++iov_count_;
+  bytes_to_send_ += static_cast<int>(length);
 }
 
-bool HttpConnection::write() {
-  int temp = 0;
+HttpConnection::ResponseMark HttpConnection::MarkResponse() const {
+  return ResponseMark{write_idx_, iov_count_, bytes_to_send_, held_count_,
+                      iov_count_ > 0 ? iov_[iov_count_ - 1].iov_len : 0};
+}
 
-  if (bytes_to_send_ == 0) {
-    ModifyFd(m_epollfd, sockfd_, EPOLLIN, trigger_mode_);
-    init();
-    return true;
+void HttpConnection::RollbackResponse(const ResponseMark& mark) {
+  write_idx_ = mark.write_idx;
+  iov_count_ = mark.iov_count;
+  bytes_to_send_ = mark.bytes_to_send;
+  for (int i = mark.held_count; i < held_count_; ++i) {
+    held_files_[i].reset();
   }
+  held_count_ = mark.held_count;
+  write_overflow_ = false;
+  // 被撤销的响应头可能已并入上一段
+  if (iov_count_ > 0) {
+    iov_[iov_count_ - 1].iov_len = mark.last_iov_len;
+  }
+}
+
+void HttpConnection::ConsumeSegments(size_t bytes) {
+  while (iov_index_ < iov_count_) {
+    struct iovec& iov = iov_[iov_index_];
+    if (bytes < iov.iov_len) {
+      if (iov.iov_base) {
+        iov.iov_base = static_cast<char*>(iov.iov_base) + bytes;
+      } else {
+        file_offset_[iov_index_] += static_cast<off_t>(bytes);
+      }
+      iov.iov_len -= bytes;
+      return;
+    }
+    bytes -= iov.iov_len;
+    iov.iov_len = 0;
+    ++iov_index_;
+  }
+}
+
+bool HttpConnection::write() {
+  int temp = 0;
 
   while (1) {
-    temp = writev(sockfd_, iov_, iov_count_);
+    if (bytes_to_send_ <= 0) {
+      // 排队的响应已全部发出
+      ResetResponses();
+      if (deferred_ != HttpCode::kNoRequest) {
+        // 之前放不进写缓冲区的流水线响应，此时写缓冲区已空
+        HttpCode ret = deferred_;
+        deferred_ = HttpCode::kNoRequest;
+        if (!ProcessWrite(ret)) return false;
+        FinishRequest();
+        continue;
+      }
+
+      // 短连接不再注册事件，由事件循环负责关闭
+      if (!linger_) {
+        read_buf_.Reset();
+        return false;
+      }
+
+      // 必须先整理好状态再重新注册事件，否则其他工作线程可能读到旧状态。
+      // 已有完整的流水线请求时不注册事件，由调用方直接派发处理
+      CompactReadBuffer();
+      if (!buffered_request_) {
+        ModifyFd(epollfd_, sockfd_, EPOLLIN, trigger_mode_);
+      }
+      return true;
+    }
+
+    struct iovec& head = iov_[iov_index_];
+    if (head.iov_base == nullptr) {
+      // 零拷贝发送文件区间，偏移量随已发送字节推进，EAGAIN 后从断点继续
+      off_t offset = file_offset_[iov_index_];
+      const CachedFile& file = *held_files_[segment_file_[iov_index_]];
+      temp = static_cast<int>(
+          sendfile(sockfd_, file.fd(), &offset, head.iov_len));
+      if (temp == 0) {
+        // 文件在发送过程中被截短
+        ReleaseFile();
+        return false;
+      }
+    } else {
+      // 连续的内存段一次发出，流水线上的多个响应也合并在同一次调用中；
+      // 其后紧跟 sendfile 段时带 MSG_MORE，让响应头与文件内容合并成完整的报文段
+      int end = iov_index_;
+      while (end < iov_count_ && iov_[end].iov_base != nullptr) ++end;
+      struct msghdr msg {};
+      msg.msg_iov = &head;
+      msg.msg_iovlen = static_cast<size_t>(end - iov_index_);
+      temp = static_cast<int>(
+          sendmsg(sockfd_, &msg, end < iov_count_ ? MSG_MORE : 0));
+    }
 
     if (temp < 0) {
       // If the sending buffer is full, wait for the next EPOLLOUT event.
       // For other errors, assume the connection is closed.
       if (errno == EAGAIN) {
-        ModifyFd(m_epollfd, sockfd_, EPOLLOUT, trigger_mode_);
+        ModifyFd(epollfd_, sockfd_, EPOLLOUT, trigger_mode_);
         return true;
       }
       // Handle other errors, such as EPIPE, ECONNRESET, etc.
-      Unmap();
+      ReleaseFile();
       return false;
     }
 
     bytes_have_send_ += temp;
     bytes_to_send_ -= temp;
-    if (bytes_have_send_ >= iov_[0].iov_len) {
-      iov_[0].iov_len = 0;
-      iov_[1].iov_base = file_address_ + (bytes_have_send_ - write_idx_);
-      iov_[1].iov_len = bytes_to_send_;
-    } else {
-      iov_[0].iov_base = &write_buf_[bytes_have_send_];
-      iov_[0].iov_len = iov_[0].iov_len - bytes_have_send_;
-    }
+    ConsumeSegments(static_cast<size_t>(temp));
+  }
+}
 
-    if (bytes_to_send_ <= 0) {
-      Unmap();
-      ModifyFd(m_epollfd, sockfd_, EPOLLIN, trigger_mode_);
+// 清空发送队列并释放各响应引用的文件
+void HttpConnection::ResetResponses() {
+  write_idx_ = 0;
+  iov_count_ = 0;
+  iov_index_ = 0;
+  bytes_to_send_ = 0;
+  bytes_have_send_ = 0;
+  write_overflow_ = false;
+  for (int i = 0; i < held_count_; ++i) {
+    held_files_[i].reset();
+  }
+  held_count_ = 0;
+  for (PooledBuffer& chunk : write_chunks_) {
+    chunk.Reset();
+  }
+}
 
-      if (linger_) {
-        init();
-        return true;
-      } else {
-        return false;
-      }
+// 发送队列还能否再容纳一个响应：响应头(可能跨两块)与文件内容至少各占一段
+bool HttpConnection::HasResponseRoom() const {
+  return iov_count_ + 3 <= kMaxIovecs && held_count_ < kMaxHeldFiles &&
+         write_idx_ < static_cast<int>(kMaxWriteChunks * BufferPool::kChunkSize);
+}
+
+char* HttpConnection::WriteCursor() {
+  size_t chunk = static_cast<size_t>(write_idx_) / BufferPool::kChunkSize;
+  if (chunk >= static_cast<size_t>(kMaxWriteChunks)) {
+    return nullptr;
+  }
+  if (!write_chunks_[chunk]) {
+    write_chunks_[chunk].Allocate(BufferPool::kChunkSize);
+  }
+  return write_chunks_[chunk].data() +
+         static_cast<size_t>(write_idx_) % BufferPool::kChunkSize;
+}
+
+bool HttpConnection::AppendResponse(const char* data, size_t length) {
+  while (length > 0) {
+    char* cursor = WriteCursor();
+    if (cursor == nullptr) {
+      return false;
     }
+    size_t room = BufferPool::kChunkSize -
+                  static_cast<size_t>(write_idx_) % BufferPool::kChunkSize;
+    size_t n = std::min(room, length);
+    memcpy(cursor, data, n);
+    write_idx_ += static_cast<int>(n);
+    data += n;
+    length -= n;
   }
+  return true;
 }
 
+// 直接格式化到当前块的剩余空间，放不下时完整格式化后跨块复制
 bool HttpConnection::AddResponse(const char* format, ...) {
-  if (write_idx_ >= kWriteBufferSize) return false;
+  char* cursor = WriteCursor();
+  if (cursor == nullptr) {
+    write_overflow_ = true;
+    return false;
+  }
+  size_t room = BufferPool::kChunkSize -
+                static_cast<size_t>(write_idx_) % BufferPool::kChunkSize;
   va_list arg_list;
   va_start(arg_list, format);
-  int len = vsnprintf(&write_buf_[write_idx_], kWriteBufferSize - 1 - write_idx_,
-                      format, arg_list);
-  if (len >= (kWriteBufferSize - 1 - write_idx_)) {
-    va_end(arg_list);
+  va_list retry;
+  va_copy(retry, arg_list);
+  int len = vsnprintf(cursor, room, format, arg_list);
+  va_end(arg_list);
+
+  bool ok = len >= 0;
+  const char* text = cursor;
+  std::vector<char> spill;
+  if (ok && static_cast<size_t>(len) < room) {
+    write_idx_ += len;
+  } else if (ok) {
+    spill.resize(static_cast<size_t>(len) + 1);
+    vsnprintf(spill.data(), spill.size(), format, retry);
+    text = spill.data();
+    ok = AppendResponse(text, static_cast<size_t>(len));
+  }
+  va_end(retry);
+  if (!ok) {
+    write_overflow_ = true;
     return false;
   }
-  write_idx_ += len;
-  va_end(arg_list);
 
-  LOG_INFO("request:%s", &write_buf_[0]);
+  LOG_DEBUG("request:%.*s",
+            std::string_view(text, static_cast<size_t>(len)));
 
   return true;
 }
 
 bool HttpConnection::AddStatusLine(int status, const char* title) {
+  status_ = status;
   return AddResponse("%s %d %s\r\n", "HTTP/1.1", status, title);
 }
 
@@ -559,8 +956,8 @@ bool HttpConnection::AddContentLength(int content_len) {
   return AddResponse("Content-Length:%d\r\n", content_len);
 }
 
-bool HttpConnection::AddContentType() {
-  return AddResponse("Content-Type:%s\r\n", "text/html");
+bool HttpConnection::AddContentType(const char* type) {
+  return AddResponse("Content-Type:%s\r\n", type);
 }
 
 bool HttpConnection::AddLinger() {
@@ -570,11 +967,31 @@ bool HttpConnection::AddLinger() {
 
 bool HttpConnection::AddBlankLine() { return AddResponse("%s", "\r\n"); }
 
+bool HttpConnection::AddEncodingHeaders() {
+  if (content_encoding_ != ContentEncoding::kIdentity &&
+      !AddResponse("Content-Encoding:%s\r\n", EncodingToken(content_encoding_))) {
+    return false;
+  }
+  return !vary_encoding_ || AddResponse("Vary:Accept-Encoding\r\n");
+}
+
+bool HttpConnection::AddValidators(const char* etag,
+                                   const char* last_modified) {
+  if (!AddResponse("ETag:%s\r\nLast-Modified:%s\r\n", etag, last_modified)) {
+    return false;
+  }
+  const char* cache_control = FindCacheControl(url_);
+  return !cache_control || AddResponse("Cache-Control:%s\r\n", cache_control);
+}
+
 bool HttpConnection::AddContent(const char* content) {
   return AddResponse("%s", content);
 }
 
 bool HttpConnection::ProcessWrite(HttpCode ret) {
+  // 流水线请求的响应接在前面尚未发出的响应之后
+  const ResponseMark mark = MarkResponse();
+  response_begin_ = mark.bytes_to_send;
   switch (ret) {
     case HttpCode::kInternalError: {
       AddStatusLine(500, kError500Title);
@@ -594,44 +1011,168 @@ bool HttpConnection::ProcessWrite(HttpCode ret) {
       if (!AddContent(kError403Form)) return false;
       break;
     }
+    case HttpCode::kRangeNotSatisfiable: {
+      AddStatusLine(416, kError416Title);
+      AddResponse("Content-Range:bytes */%zu\r\n", file_->size());
+      AddHeaders(strlen(kError416Form));
+      if (!AddContent(kError416Form)) return false;
+      break;
+    }
+    case HttpCode::kNotModified: {
+      // 304 不带消息体，只回送验证器
+      char last_modified[32];
+      FormatHttpDate(not_modified_mtime_, last_modified,
+                     sizeof(last_modified));
+      AddStatusLine(304, kNotModified304Title);
+      if (!AddValidators(not_modified_etag_, last_modified) ||
+          (vary_encoding_ && !AddResponse("Vary:Accept-Encoding\r\n")) ||
+          !AddLinger() || !AddBlankLine()) {
+        return false;
+      }
+      break;
+    }
+    case HttpCode::kPartialContent:
+      if (AddPartialContent()) {
+        return true;
+      }
+      RollbackResponse(mark);
+      if (mark.iov_count > 0) {
+        // 排在其他响应之后放不下，等发送队列清空后再生成
+        write_overflow_ = true;
+        return false;
+      }
+      // 独占发送队列仍放不下时退回发送完整文件，Range 本就允许被忽略
+      return ProcessWrite(HttpCode::kFileRequest);
     case HttpCode::kFileRequest: {
       AddStatusLine(200, kOk200Title);
-      if (file_stat_.st_size != 0) {
-        AddHeaders(file_stat_.st_size);
-        iov_[0].iov_base = &write_buf_[0];
-        iov_[0].iov_len = write_idx_;
-        iov_[1].iov_base = file_address_;
-        iov_[1].iov_len = file_stat_.st_size;
-        iov_count_ = 2;
-        bytes_to_send_ = write_idx_ + file_stat_.st_size;
-        return true;
+      if (file_->size() != 0) {
+        AddResponse("Accept-Ranges:bytes\r\n");
+        AddValidators(file_->etag(), file_->last_modified());
+        AddContentType(content_type_);
+        AddEncodingHeaders();
+        AddHeaders(static_cast<int>(file_->size()));
+        AddBufferSegment(mark.write_idx, write_idx_);
+        AddFileSegment(0, file_->size());
+        return !write_overflow_;
       } else {
         const char* ok_string = "<html><body></body></html>";
         AddHeaders(strlen(ok_string));
         if (!AddContent(ok_string)) return false;
       }
+      break;
     }
     default:
       return false;
   }
-  iov_[0].iov_base = &write_buf_[0];
-  iov_[0].iov_len = write_idx_;
-  iov_count_ = 1;
-  bytes_to_send_ = write_idx_;
+  AddBufferSegment(mark.write_idx, write_idx_);
+  return !write_overflow_;
+}
+
+// 206 响应：单区间直接发送文件片段；多区间按 multipart/byteranges 组织，
+// 各分段头写入写缓冲块，分段内容直接引用文件，不做拷贝
+bool HttpConnection::AddPartialContent() {
+  int response_begin = write_idx_;
+  size_t size = file_->size();
+  // 响应头、每个区间的分段头与内容、结束分隔符各占一段，
+  // 另留一段给跨越写缓冲块边界的字节
+  int segments = (range_count_ == 1 ? 2 : 2 * range_count_ + 2) + 1;
+  if (iov_count_ + segments > kMaxIovecs) {
+    return false;
+  }
+  AddStatusLine(206, kPartial206Title);
+  AddValidators(file_->etag(), file_->last_modified());
+  AddEncodingHeaders();
+
+  if (range_count_ == 1) {
+    const ByteRange& range = ranges_[0];
+    size_t length = range.last - range.first + 1;
+    AddContentType(content_type_);
+    AddResponse("Content-Range:bytes %zu-%zu/%zu\r\n", range.first,
+                range.last, size);
+    if (!AddHeaders(static_cast<int>(length))) return false;
+    AddBufferSegment(response_begin, write_idx_);
+    AddFileSegment(range.first, length);
+    return true;
+  }
+
+  char boundary[20];
+  snprintf(boundary, sizeof(boundary), "%016" PRIx64,
+           g_boundary_seq.fetch_add(1, std::memory_order_relaxed));
+
+  // 先格式化各分段头以计算 Content-Length
+  char part_headers[kMaxRanges][192];
+  size_t body_length = 0;
+  size_t file_bytes = 0;
+  for (int i = 0; i < range_count_; ++i) {
+    const ByteRange& range = ranges_[i];
+    int len = snprintf(part_headers[i], sizeof(part_headers[i]),
+                       "\r\n--%s\r\nContent-Type: %s\r\n"
+                       "Content-Range: bytes %zu-%zu/%zu\r\n\r\n",
+                       boundary, content_type_, range.first, range.last, size);
+    if (len < 0 || static_cast<size_t>(len) >= sizeof(part_headers[i])) {
+      return false;
+    }
+    body_length += static_cast<size_t>(len);
+    file_bytes += range.last - range.first + 1;
+  }
+  char trailer[32];
+  int trailer_len =
+      snprintf(trailer, sizeof(trailer), "\r\n--%s--\r\n", boundary);
+  body_length += file_bytes + static_cast<size_t>(trailer_len);
+
+  AddResponse("Content-Type:multipart/byteranges; boundary=%s\r\n", boundary);
+  if (!AddHeaders(static_cast<int>(body_length))) return false;
+  AddBufferSegment(response_begin, write_idx_);
+  for (int i = 0; i < range_count_; ++i) {
+    int begin = write_idx_;
+    if (!AddContent(part_headers[i])) return false;
+    AddBufferSegment(begin, write_idx_);
+    AddFileSegment(ranges_[i].first, ranges_[i].last - ranges_[i].first + 1);
+  }
+  int begin = write_idx_;
+  if (!AddContent(trailer)) return false;
+  AddBufferSegment(begin, write_idx_);
   return true;
 }
 
-void HttpConnection::process() {
+bool HttpConnection::process() {
+  // 缓冲的请求由本次处理接手，发送未完成时不得再次派发
+  buffered_request_ = false;
   HttpCode read_ret = ProcessRead();
   if (read_ret == HttpCode::kNoRequest) {
-    ModifyFd(m_epollfd, sockfd_, EPOLLIN, trigger_mode_);
-    return;
+    ModifyFd(epollfd_, sockfd_, EPOLLIN, trigger_mode_);
+    return true;
   }
   bool write_ret = ProcessWrite(read_ret);
   if (!write_ret) {
-    close_conn();
+    // 关闭交给事件循环完成，以便同时移除定时器
+    return false;
+  }
+  FinishRequest();
+
+  // 流水线：已完整到达的后续请求接着处理，响应排在同一批中一起发出
+  while (linger_ && HasResponseRoom()) {
+    read_ret = ProcessRead();
+    if (read_ret == HttpCode::kNoRequest) break;
+    const ResponseMark mark = MarkResponse();
+    if (!ProcessWrite(read_ret)) {
+      if (!write_overflow_) return false;
+      // 写缓冲区已满，撤销这条响应，待前面的响应发完后重新生成
+      RollbackResponse(mark);
+      deferred_ = read_ret;
+      break;
+    }
+    FinishRequest();
+  }
+  ModifyFd(epollfd_, sockfd_, EPOLLOUT, trigger_mode_);
+  return true;
+}
+
+void HttpConnection::PostCompletion(CompletionType type) {
+  if (completion_queue_ == nullptr ||
+      !completion_queue_->Push(Completion{sockfd_, type})) {
+    LOG_ERROR("post completion failed for fd %d", sockfd_);
   }
-  ModifyFd(m_epollfd, sockfd_, EPOLLOUT, trigger_mode_);
 }
 
 // Helper function for timer callback
@@ -11,20 +11,32 @@
 #include <signal.h>
 #include <sys/epoll.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
-#include <map>
+#include <atomic>
+#include <memory>
 #include <mysql/mysql.h>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "../CGImysql/sql_connection_pool.h"
+#include "../CGImysql/user_store.h"
+#include "../log/access_log.h"
 #include "../log/log.h"
+#include "../threadpool/completion_queue.h"
 #include "../timer/lst_timer.h"
+#include "buffer_pool.h"
+#include "content_encoding.h"
+#include "file_cache.h"
+#include "http_parser.h"
+#include "mime_types.h"
 
 namespace tinywebserver {
 
@@ -33,8 +45,21 @@ class HttpConnection {
  public:
   // Constants
   static constexpr int kFileNameLen = 200;
-  static constexpr int kReadBufferSize = 2048;
-  static constexpr int kWriteBufferSize = 1024;
+  // Largest request (headers and body) a connection buffers. The read
+  // buffer starts as one pooled chunk and doubles up to this size.
+  static constexpr size_t kMaxReadBufferSize = 64 * 1024;
+  // Generated response bytes are written across up to this many pooled
+  // chunks; pipelined responses beyond that wait for the queue to drain.
+  static constexpr int kMaxWriteChunks = 4;
+  // Ranges served in one 206 response; longer Range headers are ignored.
+  // Bounded so a multipart response fits in the send queue.
+  static constexpr int kMaxRanges = 6;
+  // Response header, a header and body per range, the closing boundary,
+  // and one more for generated bytes straddling two write chunks.
+  // Pipelined responses share the segments, as many as fit.
+  static constexpr int kMaxIovecs = 2 * kMaxRanges + 3;
+  // Distinct files referenced by the queued responses of one connection
+  static constexpr int kMaxHeldFiles = 4;
 
   // HTTP method enumeration
   enum class Method {
@@ -49,13 +74,6 @@ class HttpConnection {
     kPatch
   };
 
-  // Parse state enumeration
-  enum class CheckState {
-    kRequestLine = 0,
-    kHeader,
-    kContent
-  };
-
   // HTTP status code enumeration
   enum class HttpCode {
     kNoRequest,
@@ -64,17 +82,13 @@ class HttpConnection {
     kNoResource,
     kForbiddenRequest,
     kFileRequest,
+    kNotModified,
+    kPartialContent,
+    kRangeNotSatisfiable,
     kInternalError,
     kClosedConnection
   };
 
-  // Line parsing status
-  enum class LineStatus {
-    kOk = 0,
-    kBad,
-    kOpen
-  };
-
   HttpConnection() = default;
   ~HttpConnection();
 
@@ -89,22 +103,20 @@ class HttpConnection {
   // Initializes the HTTP connection.
   // @param sockfd Socket file descriptor
   // @param addr Client address
+  // @param epollfd Epoll instance of the sub-reactor owning the socket
+  // @param completion_queue Completion queue of the owning sub-reactor
   // @param root Document root directory
   // @param trigger_mode Trigger mode (0=LT, 1=ET)
-  // @param close_log Log disable flag
-  // @param user Database username
-  // @param passwd Database password
-  // @param sqlname Database name
-  void init(int sockfd, const sockaddr_in& addr, char* root, int trigger_mode,
-            int close_log, const std::string& user, const std::string& passwd,
-            const std::string& sqlname);
+  void init(int sockfd, const sockaddr_in& addr, int epollfd,
+            CompletionQueue* completion_queue, char* root, int trigger_mode);
 
   // Closes the connection.
   // @param real_close Whether to actually close the socket
   void close_conn(bool real_close = true);
 
   // Processes the HTTP request.
-  void process();
+  // @return false if the connection should be closed
+  bool process();
 
   // Reads data from socket once (non-blocking).
   // @return true if read successfully, false otherwise
@@ -114,91 +126,200 @@ class HttpConnection {
   // @return true if write successfully, false otherwise
   bool write();
 
+  // Whether a complete pipelined request is waiting in the read buffer
+  // after write() finished sending. The socket is not rearmed in that
+  // case; the caller must run process() again.
+  bool HasBufferedRequest() const { return buffered_request_; }
+
   // Gets client address.
   sockaddr_in* get_address() { return &address_; }
 
-  // Initializes MySQL result set with user data.
-  // @param conn_pool Connection pool
-  void initmysql_result(ConnectionPool* conn_pool);
+  // Posts a completion for this connection to the owning event loop.
+  // Called by worker threads once they are done with the connection.
+  // @param type Action the event loop should take
+  void PostCompletion(CompletionType type);
+
+  // Sets the Cache-Control value sent with static files. Call before
+  // serving requests.
+  // @param rules (URL prefix, directives) pairs; the longest matching
+  //        prefix applies
+  static void SetCacheControlRules(
+      std::vector<std::pair<std::string, std::string>> rules);
 
-  // Public members for timer and state management
-  int timer_flag{0};
-  int improv{0};
-  int m_state{0};  // 0=read, 1=write
-  MYSQL* mysql{nullptr};
+  // Sets how text files are compressed. Call before serving requests.
+  // @param mode 0=never, 1=precompressed .br/.gz siblings only,
+  //        2=siblings, else a cached in-memory compressed variant
+  static void SetCompression(int mode);
 
   // Static members
-  static int m_epollfd;
-  static int m_user_count;
+  static std::atomic<int> m_user_count;
 
  private:
   // Internal initialization
   void init();
+  // Clears the state of one request; queued responses are kept.
+  void ResetRequest();
+  // Moves past the request whose response has been queued.
+  void FinishRequest();
+  // Records the request whose response has just been queued in the
+  // access log and starts timing the next pipelined request.
+  void LogAccess();
+  // Moves unparsed pipelined bytes to the front of read_buf_, returning
+  // the buffer to the pool if nothing is left.
+  void CompactReadBuffer();
+  // Makes room for at least one more byte in read_buf_.
+  // @return false once the buffer has reached kMaxReadBufferSize
+  bool ReserveReadSpace();
 
   // HTTP parsing
   HttpCode ProcessRead();
   bool ProcessWrite(HttpCode ret);
 
-  HttpCode ParseRequestLine(char* text);
-  HttpCode ParseHeaders(char* text);
-  HttpCode ParseContent(char* text);
+  // Validates the parsed request line and picks out the target URL.
+  HttpCode ParseRequestLine();
+  // Picks out the headers the server acts on.
+  void ParseHeaders();
   HttpCode DoRequest();
 
-  char* GetLine() { return &read_buf_[start_line_]; }
-  LineStatus ParseLine();
-
-  void Unmap();
+  // Picks a precompressed sibling or compressed variant the client accepts.
+  // @return kNoRequest to send the identity file
+  HttpCode NegotiateEncoding();
+
+  // Acquires the file to send, answering conditional requests first.
+  // @param path File to send
+  // @param compress Coding of the cached variant to send, or kIdentity
+  HttpCode AcquireFile(const std::string& path, ContentEncoding compress);
+
+  // Resolves the Range / If-Range headers against the served file.
+  // @return kFileRequest to send the whole file, kPartialContent with
+  //         ranges_ filled in, or kRangeNotSatisfiable
+  HttpCode ResolveRange();
+  bool IfRangeMatches() const;
+
+  // Evaluates If-None-Match / If-Modified-Since against a file version.
+  // @param etag Entity tag of the version
+  // @param mtime Modification time of the version
+  // @return true if the client's copy is current
+  bool NotModified(const char* etag, time_t mtime) const;
+
+  // Drops this connection's references to served files.
+  void ReleaseFile();
+
+  // Response body segments, sent in order by write().
+  // Appends bytes [begin, end) of the write chunks.
+  void AddBufferSegment(int begin, int end);
+  // Appends a range of the served file: mapped bytes when the file is
+  // mapped, otherwise a sendfile segment.
+  void AddFileSegment(size_t offset, size_t length);
+  // Advances past bytes the socket accepted.
+  void ConsumeSegments(size_t bytes);
+  // Empties the send queue once everything has been sent and returns the
+  // write chunks to the pool.
+  void ResetResponses();
+  // @return true if another pipelined response can be queued
+  bool HasResponseRoom() const;
+
+  // Send queue position, used to drop a response that did not fit
+  struct ResponseMark {
+    int write_idx;
+    int iov_count;
+    int bytes_to_send;
+    int held_count;
+    size_t last_iov_len;
+  };
+  ResponseMark MarkResponse() const;
+  void RollbackResponse(const ResponseMark& mark);
 
   // Response building
+  // @return Write position, allocating its chunk; null when all
+  //         kMaxWriteChunks are full
+  char* WriteCursor();
+  // Copies bytes to the write position, spanning chunks as needed.
+  bool AppendResponse(const char* data, size_t length);
   bool AddResponse(const char* format, ...);
   bool AddContent(const char* content);
   bool AddStatusLine(int status, const char* title);
   bool AddHeaders(int content_length);
-  bool AddContentType();
+  bool AddContentType(const char* type);
   bool AddContentLength(int content_length);
   bool AddLinger();
   bool AddBlankLine();
+  bool AddPartialContent();
+  bool AddValidators(const char* etag, const char* last_modified);
+  bool AddEncodingHeaders();
 
  private:
+  // Hot state, touched on every event of the connection: kept together at
+  // the front so an event reads one or two cache lines.
   int sockfd_{-1};
-  sockaddr_in address_{};
-
-  std::vector<char> read_buf_;
-  size_t read_idx_{0};
-  size_t checked_idx_{0};
-  int start_line_{0};
-
-  std::vector<char> write_buf_;
+  int epollfd_{-1};
+  int trigger_mode_{0};
   int write_idx_{0};
-
-  CheckState check_state_{CheckState::kRequestLine};
-  Method method_{Method::kGet};
-
-  std::vector<char> real_file_;
-  char* url_{nullptr};
-  char* version_{nullptr};
-  char* host_{nullptr};
-  size_t content_length_{0};
-  bool linger_{false};
-
-  char* file_address_{nullptr};
-  struct stat file_stat_{};
-  struct iovec iov_[2]{};
   int iov_count_{0};
-
-  int cgi_{0};
-  char* string_{nullptr};
+  int iov_index_{0};  // First segment not fully sent
   int bytes_to_send_{0};
   int bytes_have_send_{0};
-  char* doc_root_{nullptr};
-
-  std::map<std::string, std::string> users_;
-  int trigger_mode_{0};
-  int close_log_{0};
+  size_t read_idx_{0};
+  size_t request_start_{0};  // Start of the current pipelined request
+  bool linger_{false};
+  bool buffered_request_{false};
+  bool write_overflow_{false};  // An AddResponse call ran out of room
+  // Pipelined request whose response is built once the queue drains
+  HttpCode deferred_{HttpCode::kNoRequest};
+  CompletionQueue* completion_queue_{nullptr};
+  PooledBuffer read_buf_;  // Empty while the connection is idle
+  // Generated response bytes, filled sequentially; write_idx_ counts bytes
+  // from the start of the first chunk. Empty while nothing is queued.
+  PooledBuffer write_chunks_[kMaxWriteChunks];
+
+  // Cold state, touched while parsing a request and building its response
+  sockaddr_in address_{};
+  HttpRequestParser parser_;
+  Method method_{Method::kGet};
+  // Access log state of the current request
+  struct timespec request_begin_{};  // First read of the request
+  int response_begin_{0};  // bytes_to_send_ before its response was queued
+  int status_{0};          // Status code of its response
+
+  // Request fields are views into read_buf_; an empty view means absent
+  std::string_view url_;
+  std::string_view host_;
+  std::string_view range_;              // Range header value
+  std::string_view if_range_;           // If-Range header value
+  std::string_view if_none_match_;      // If-None-Match header value
+  std::string_view if_modified_since_;  // If-Modified-Since header value
+  time_t not_modified_mtime_{0};      // File version a 304 refers to
+  char not_modified_etag_[64]{};      // Entity tag of that version
+  std::string_view accept_encoding_;  // Accept-Encoding header value
+  ContentEncoding content_encoding_{ContentEncoding::kIdentity};
+  const char* content_type_{kDefaultMimeType};  // MIME type of the target
+  bool vary_encoding_{false};  // Response depends on Accept-Encoding
+
+  // Byte range of the served file, inclusive on both ends
+  struct ByteRange {
+    size_t first;
+    size_t last;
+  };
+  ByteRange ranges_[kMaxRanges]{};
+  int range_count_{0};
+
+  std::shared_ptr<const CachedFile> file_;  // File being served, if any
+  const char* file_address_{nullptr};
+  // Response segments. A null iov_base marks a file range sent with
+  // sendfile, whose current offset is kept in file_offset_.
+  struct iovec iov_[kMaxIovecs]{};
+  off_t file_offset_[kMaxIovecs]{};
+  // Index into held_files_ of a file segment, -1 for write chunk segments
+  int8_t segment_file_[kMaxIovecs]{};
+  // Files the queued responses point into
+  std::shared_ptr<const CachedFile> held_files_[kMaxHeldFiles];
+  int held_count_{0};
 
-  std::vector<char> sql_user_;
-  std::vector<char> sql_passwd_;
-  std::vector<char> sql_name_;
+  int cgi_{0};
+  std::string_view body_;  // POST body
+  char* doc_root_{nullptr};
+  size_t doc_root_len_{0};  // real_file_ always starts with doc_root_
+  char real_file_[kFileNameLen]{};
 };
 
 // Utility functions
@@ -0,0 +1,234 @@
+// Copyright 2025 TinyWebServer
+// HTTP/1.1 请求解析器的实现
+
+#include "http_parser.h"
+
+#include <strings.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TINYWEBSERVER_X86_SIMD 1
+#endif
+
+namespace tinywebserver {
+
+namespace {
+
+using ScanFunction = const char* (*)(const char*, const char*, char, char);
+
+// 逐字节查找 a 或 b，用于非 x86 平台和 SIMD 处理后剩余的尾部
+const char* ScanScalar(const char* p, const char* end, char a, char b) {
+  for (; p < end; ++p) {
+    if (*p == a || *p == b) return p;
+  }
+  return end;
+}
+
+#ifdef TINYWEBSERVER_X86_SIMD
+// 每次比较 16 字节，x86-64 必定支持 SSE2
+const char* ScanSse2(const char* p, const char* end, char a, char b) {
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+  }
+  return ScanScalar(p, end, a, b);
+}
+
+// 每次比较 32 字节，只在运行时检测到 AVX2 时使用
+__attribute__((target("avx2"))) const char* ScanAvx2(const char* p,
+                                                     const char* end, char a,
+                                                     char b) {
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  for (; end - p >= 32; p += 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    int mask = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb)));
+    if (mask != 0) {
+      return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+  }
+  return ScanSse2(p, end, a, b);
+}
+
+ScanFunction SelectScan() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? ScanAvx2 : ScanSse2;
+}
+#else
+ScanFunction SelectScan() { return ScanScalar; }
+#endif
+
+// 启动时按 CPU 特性选定一次
+const ScanFunction g_scan = SelectScan();
+
+bool IsWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+const char* SkipWhitespace(const char* p, const char* end) {
+  while (p < end && IsWhitespace(*p)) ++p;
+  return p;
+}
+
+const char* FindWhitespace(const char* p, const char* end) {
+  while (p < end && !IsWhitespace(*p)) ++p;
+  return p;
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+}  // namespace
+
+const char* FindLineDelimiter(const char* begin, const char* end) {
+  return g_scan(begin, end, '\r', '\n');
+}
+
+const char* FindByte(const char* begin, const char* end, char byte) {
+  return g_scan(begin, end, byte, byte);
+}
+
+void HttpRequestParser::Reset() {
+  state_ = State::kRequestLine;
+  line_start_ = 0;
+  scan_pos_ = 0;
+  method_ = Slice{};
+  target_ = Slice{};
+  version_ = Slice{};
+  header_count_ = 0;
+  has_content_length_ = false;
+  content_length_ = 0;
+  body_ = Slice{};
+}
+
+HttpRequestParser::Status HttpRequestParser::Parse(const char* data,
+                                                   size_t size) {
+  base_ = data;
+  if (size > UINT32_MAX) {
+    return Status::kError;
+  }
+  const char* end = data + size;
+
+  while (state_ == State::kRequestLine || state_ == State::kHeaders) {
+    // 从上次停下的位置继续找行尾，已扫描过的字节不再重复扫描
+    const char* delimiter = FindLineDelimiter(data + scan_pos_, end);
+    if (delimiter == end) {
+      scan_pos_ = size;
+      return Status::kIncomplete;
+    }
+    if (*delimiter == '\n') {
+      return Status::kError;  // 行尾必须是 CRLF
+    }
+    if (delimiter + 1 == end) {
+      // CR 之后的 LF 还没到，下次从 CR 处重新检查
+      scan_pos_ = static_cast<size_t>(delimiter - data);
+      return Status::kIncomplete;
+    }
+    if (delimiter[1] != '\n') {
+      return Status::kError;
+    }
+
+    const char* line = data + line_start_;
+    line_start_ = static_cast<size_t>(delimiter - data) + 2;
+    scan_pos_ = line_start_;
+
+    if (state_ == State::kRequestLine) {
+      // 请求行之前的空行可以忽略 (RFC 7230 3.5)
+      if (line == delimiter) continue;
+      if (!ParseRequestLine(line, delimiter)) return Status::kError;
+      state_ = State::kHeaders;
+    } else if (line == delimiter) {
+      body_ = Slice{static_cast<uint32_t>(line_start_), 0};
+      state_ = content_length_ != 0 ? State::kBody : State::kDone;
+    } else if (!ParseHeaderLine(line, delimiter)) {
+      return Status::kError;
+    }
+  }
+
+  if (state_ == State::kBody) {
+    if (size - body_.offset < content_length_) {
+      return Status::kIncomplete;
+    }
+    body_.length = static_cast<uint32_t>(content_length_);
+    state_ = State::kDone;
+  }
+  return Status::kComplete;
+}
+
+// 请求行：方法 SP 目标 SP 版本
+bool HttpRequestParser::ParseRequestLine(const char* line, const char* end) {
+  const char* method_end = FindWhitespace(line, end);
+  const char* target = SkipWhitespace(method_end, end);
+  const char* target_end = FindWhitespace(target, end);
+  const char* version = SkipWhitespace(target_end, end);
+  const char* version_end = FindWhitespace(version, end);
+  if (method_end == line || target_end == target || version_end == version ||
+      SkipWhitespace(version_end, end) != end) {
+    return false;
+  }
+  method_ = Slice{static_cast<uint32_t>(line - base_),
+                  static_cast<uint32_t>(method_end - line)};
+  target_ = Slice{static_cast<uint32_t>(target - base_),
+                  static_cast<uint32_t>(target_end - target)};
+  version_ = Slice{static_cast<uint32_t>(version - base_),
+                   static_cast<uint32_t>(version_end - version)};
+  return true;
+}
+
+// 头部行：名称 ":" OWS 值 OWS
+bool HttpRequestParser::ParseHeaderLine(const char* line, const char* end) {
+  // 不支持已废弃的折行，名称与冒号之间也不允许有空白 (RFC 7230 3.2.4)
+  const char* colon = FindByte(line, end, ':');
+  if (colon == end || colon == line || IsWhitespace(line[0]) ||
+      IsWhitespace(colon[-1])) {
+    return false;
+  }
+  if (header_count_ == kMaxHeaders) {
+    return false;
+  }
+  const char* value = SkipWhitespace(colon + 1, end);
+  const char* value_end = end;
+  while (value_end > value && IsWhitespace(value_end[-1])) --value_end;
+
+  std::string_view name(line, static_cast<size_t>(colon - line));
+  if (EqualsIgnoreCase(name, "Content-Length")) {
+    // 长度决定了请求的边界，格式不合法或重复且不一致时拒绝请求
+    if (value == value_end) return false;
+    size_t length = 0;
+    for (const char* p = value; p < value_end; ++p) {
+      if (*p < '0' || *p > '9') return false;
+      length = length * 10 + static_cast<size_t>(*p - '0');
+      if (length > UINT32_MAX) return false;
+    }
+    if (has_content_length_ && length != content_length_) return false;
+    has_content_length_ = true;
+    content_length_ = length;
+  } else if (EqualsIgnoreCase(name, "Transfer-Encoding")) {
+    // 不支持分块传输，无法确定请求体的边界
+    return false;
+  }
+
+  headers_[header_count_++] = HeaderSlice{
+      Slice{static_cast<uint32_t>(line - base_),
+            static_cast<uint32_t>(name.size())},
+      Slice{static_cast<uint32_t>(value - base_),
+            static_cast<uint32_t>(value_end - value)}};
+  return true;
+}
+
+std::string_view HttpRequestParser::FindHeader(std::string_view name) const {
+  for (int i = 0; i < header_count_; ++i) {
+    if (EqualsIgnoreCase(View(headers_[i].name), name)) {
+      return View(headers_[i].value);
+    }
+  }
+  return std::string_view();
+}
+
+}  // namespace tinywebserver
@@ -0,0 +1,110 @@
+// Copyright 2025 TinyWebServer
+// Resumable, zero-copy HTTP/1.1 request parser
+// Follows Google C++ Style Guide
+
+#ifndef TINYWEBSERVER_HTTP_HTTP_PARSER_H_
+#define TINYWEBSERVER_HTTP_HTTP_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace tinywebserver {
+
+// Parses one HTTP/1.1 request out of a connection's read buffer.
+//
+// The parser never copies or modifies the buffer: the request line, header
+// names and values and the body are exposed as string_views into it. Line
+// ends and header colons are located with SSE2/AVX2 when available.
+// Parse() may be called again after more bytes arrive and resumes where the
+// previous call stopped, so a partially received request is scanned once.
+// Offsets rather than pointers are kept between calls, so the buffer may be
+// moved as long as its contents are preserved.
+class HttpRequestParser {
+ public:
+  enum class Status {
+    kIncomplete = 0,  // Need more bytes
+    kComplete,        // A full request (including body) is available
+    kError            // Malformed or unsupported request
+  };
+
+  struct Header {
+    std::string_view name;
+    std::string_view value;  // Leading and trailing whitespace removed
+  };
+
+  // Headers beyond this count make the request malformed
+  static constexpr int kMaxHeaders = 48;
+
+  // Prepares for a new request. O(1).
+  void Reset();
+
+  // Parses as much of the request as is available.
+  // @param data Start of the request in the read buffer
+  // @param size Bytes received so far, starting at data
+  // @return kComplete once the headers and Content-Length body bytes have
+  //         arrived; views stay valid until the buffer is modified
+  Status Parse(const char* data, size_t size);
+
+  std::string_view method() const { return View(method_); }
+  std::string_view target() const { return View(target_); }
+  std::string_view version() const { return View(version_); }
+  int header_count() const { return header_count_; }
+  Header header(int index) const {
+    return Header{View(headers_[index].name), View(headers_[index].value)};
+  }
+  std::string_view body() const { return View(body_); }
+  size_t content_length() const { return content_length_; }
+  // Bytes of the parsed request, i.e. where a pipelined request would start
+  size_t message_length() const { return body_.offset + body_.length; }
+
+  // Finds a header by name (case-insensitive).
+  // @return Its value, or an empty view if absent
+  std::string_view FindHeader(std::string_view name) const;
+
+ private:
+  enum class State { kRequestLine = 0, kHeaders, kBody, kDone };
+
+  // Position of a token relative to the start of the request
+  struct Slice {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  std::string_view View(Slice slice) const {
+    return std::string_view(base_ + slice.offset, slice.length);
+  }
+
+  bool ParseRequestLine(const char* line, const char* end);
+  bool ParseHeaderLine(const char* line, const char* end);
+
+  const char* base_{nullptr};
+  State state_{State::kRequestLine};
+  size_t line_start_{0};  // First byte of the line being parsed
+  size_t scan_pos_{0};    // Bytes before this were searched for CR/LF
+
+  Slice method_{};
+  Slice target_{};
+  Slice version_{};
+  struct HeaderSlice {
+    Slice name;
+    Slice value;
+  };
+  HeaderSlice headers_[kMaxHeaders]{};
+  int header_count_{0};
+  bool has_content_length_{false};
+  size_t content_length_{0};
+  Slice body_{};
+};
+
+// Scans [begin, end) for the first CR or LF.
+// @return Pointer to it, or end if there is none
+const char* FindLineDelimiter(const char* begin, const char* end);
+
+// Scans [begin, end) for the first occurrence of a byte.
+// @return Pointer to it, or end if there is none
+const char* FindByte(const char* begin, const char* end, char byte);
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_HTTP_HTTP_PARSER_H_
@@ -0,0 +1,197 @@
+// Copyright 2025 TinyWebServer
+// MIME 类型表的实现：编译期构造的完美哈希 + 运行时覆盖表
+
+#include "mime_types.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+namespace tinywebserver {
+
+namespace {
+
+struct MimeEntry {
+  std::string_view extension;
+  const char* type;
+};
+
+// 内置类型表，扩展名一律小写
+constexpr MimeEntry kMimeTable[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"xml", "application/xml"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"md", "text/markdown; charset=utf-8"},
+    {"csv", "text/csv; charset=utf-8"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"ico", "image/x-icon"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"bmp", "image/bmp"},
+    {"tif", "image/tiff"},
+    {"tiff", "image/tiff"},
+    {"mp4", "video/mp4"},
+    {"m4v", "video/mp4"},
+    {"webm", "video/webm"},
+    {"ogv", "video/ogg"},
+    {"mov", "video/quicktime"},
+    {"mp3", "audio/mpeg"},
+    {"m4a", "audio/mp4"},
+    {"aac", "audio/aac"},
+    {"ogg", "audio/ogg"},
+    {"oga", "audio/ogg"},
+    {"wav", "audio/wav"},
+    {"flac", "audio/flac"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"pdf", "application/pdf"},
+    {"wasm", "application/wasm"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"tar", "application/x-tar"},
+    {"webmanifest", "application/manifest+json"},
+    {"rss", "application/rss+xml"},
+    {"atom", "application/atom+xml"},
+};
+
+constexpr size_t kEntryCount = sizeof(kMimeTable) / sizeof(kMimeTable[0]);
+// 槽位数取 2 的幂且远大于表项数，使编译期很快能找到无冲突的种子
+constexpr size_t kSlotCount = 256;
+static_assert(kEntryCount < kSlotCount, "slot index must fit in uint8_t");
+
+constexpr char ToLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// 带种子的 FNV-1a，比较前先转小写
+constexpr uint32_t Hash(std::string_view text, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (char c : text) {
+    hash ^= static_cast<unsigned char>(ToLower(c));
+    hash *= 16777619u;
+  }
+  return hash ^ (hash >> 16);
+}
+
+struct PerfectHash {
+  uint32_t seed;
+  std::array<uint8_t, kSlotCount> slots;  // 表项下标 + 1，0 表示空槽
+};
+
+// 逐个尝试种子，直到所有扩展名落在互不相同的槽位上
+constexpr PerfectHash BuildPerfectHash() {
+  for (uint32_t seed = 0;; ++seed) {
+    PerfectHash result{seed, {}};
+    bool collision = false;
+    for (size_t i = 0; i < kEntryCount && !collision; ++i) {
+      uint8_t& slot =
+          result.slots[Hash(kMimeTable[i].extension, seed) & (kSlotCount - 1)];
+      if (slot != 0) {
+        collision = true;
+      } else {
+        slot = static_cast<uint8_t>(i + 1);
+      }
+    }
+    if (!collision) {
+      return result;
+    }
+  }
+}
+
+constexpr PerfectHash kPerfectHash = BuildPerfectHash();
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (ToLower(a[i]) != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 配置文件加载的覆盖表，启动时写入，之后只读；键为小写扩展名
+std::unordered_map<std::string, std::string> g_overrides;
+
+}  // namespace
+
+const char* MimeTypeFor(const char* path) {
+  const char* dot = strrchr(path, '.');
+  if (!dot || strchr(dot, '/')) {
+    return kDefaultMimeType;
+  }
+  std::string_view extension(dot + 1);
+
+  if (!g_overrides.empty()) {
+    std::string key(extension);
+    for (char& c : key) {
+      c = ToLower(c);
+    }
+    auto it = g_overrides.find(key);
+    if (it != g_overrides.end()) {
+      return it->second.c_str();
+    }
+  }
+
+  // 一次哈希、一次比较即可确定结果
+  uint8_t slot = kPerfectHash.slots[Hash(extension, kPerfectHash.seed) &
+                                    (kSlotCount - 1)];
+  if (slot != 0 && EqualsIgnoreCase(extension, kMimeTable[slot - 1].extension)) {
+    return kMimeTable[slot - 1].type;
+  }
+  return kDefaultMimeType;
+}
+
+int LoadMimeTypes(const std::string& file) {
+  std::ifstream infile(file);
+  if (!infile.is_open()) {
+    return -1;
+  }
+
+  int count = 0;
+  std::string line;
+  while (std::getline(infile, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string type;
+    // 跳过空行以及 nginx 格式外层的 "types {" 和 "}"
+    if (!(fields >> type) || type == "types" || type == "}") {
+      continue;
+    }
+    std::string extension;
+    while (fields >> extension) {
+      if (!extension.empty() && extension.back() == ';') {
+        extension.pop_back();
+      }
+      if (extension.empty()) {
+        continue;
+      }
+      for (char& c : extension) {
+        c = ToLower(c);
+      }
+      g_overrides[extension] = type;
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace tinywebserver
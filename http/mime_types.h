@@ -0,0 +1,31 @@
+// Copyright 2025 TinyWebServer
+// File extension to MIME type lookup
+// Follows Google C++ Style Guide
+
+#ifndef TINYWEBSERVER_HTTP_MIME_TYPES_H_
+#define TINYWEBSERVER_HTTP_MIME_TYPES_H_
+
+#include <string>
+
+namespace tinywebserver {
+
+// Content-Type sent for files with an unknown extension
+constexpr const char* kDefaultMimeType = "application/octet-stream";
+
+// Looks up the MIME type of a file by its extension (case-insensitive).
+// Built-in types are found through a perfect hash computed at compile
+// time; types loaded with LoadMimeTypes take precedence.
+// @param path File path or name
+// @return MIME type, kDefaultMimeType if the extension is unknown
+const char* MimeTypeFor(const char* path);
+
+// Loads extra or overriding types. Each line is "<type> <ext> [<ext>...]"
+// as in nginx's mime.types; '#' starts a comment, and trailing ';' and an
+// enclosing "types { ... }" block are ignored. Call before serving requests.
+// @param file Path of the types file
+// @return Number of extensions loaded, -1 if the file cannot be opened
+int LoadMimeTypes(const std::string& file);
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_HTTP_MIME_TYPES_H_
@@ -0,0 +1,318 @@
+// Copyright 2025 TinyWebServer
+// 访问日志的实现
+
+#include "access_log.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+
+#include "log/log.h"
+
+namespace tinywebserver {
+
+namespace {
+
+constexpr int kFieldCount = 5;  // 方法、目标、协议版本、Referer、User-Agent
+
+// 线程缓冲区中的一条记录，后面紧跟各字符串字段的内容
+struct Record {
+  struct timespec time;
+  int64_t latency_us;
+  uint64_t bytes;
+  uint32_t address;
+  uint16_t port;
+  uint16_t status;
+  uint16_t lengths[kFieldCount];
+  uint32_t size;  // 整条记录的字节数
+};
+
+// 一条记录的最大长度，记录按 8 字节对齐，多留出对齐的余量
+constexpr size_t kMaxRecordSize =
+    sizeof(Record) + kFieldCount * AccessLog::kMaxFieldSize + 8;
+
+// 暂存区大小，写满后写出一次
+constexpr size_t kStagingSize = 1024 * 1024;
+
+// 一行的最大长度：字段转义后至多膨胀为 6 倍，其余部分不超过 512 字节
+constexpr size_t kMaxLineSize =
+    kFieldCount * 6 * AccessLog::kMaxFieldSize + 512;
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+char* Append(char* out, std::string_view text) {
+  std::memcpy(out, text.data(), text.size());
+  return out + text.size();
+}
+
+template <typename T>
+char* AppendNumber(char* out, T value) {
+  // 调用方保证空间足够
+  return std::to_chars(out, out + 24, value).ptr;
+}
+
+// combined 格式的字段：空字段写 "-"，双引号、反斜杠和控制字符写成 \xHH
+char* EscapeCombined(char* out, std::string_view text) {
+  if (text.empty()) {
+    *out++ = '-';
+    return out;
+  }
+  for (char ch : text) {
+    auto byte = static_cast<unsigned char>(ch);
+    if (byte == '"' || byte == '\\' || byte < 0x20 || byte == 0x7f) {
+      *out++ = '\\';
+      *out++ = 'x';
+      *out++ = kHexDigits[byte >> 4];
+      *out++ = kHexDigits[byte & 0xf];
+    } else {
+      *out++ = ch;
+    }
+  }
+  return out;
+}
+
+// JSON 字符串的内容，按 RFC 8259 转义
+char* EscapeJson(char* out, std::string_view text) {
+  for (char ch : text) {
+    auto byte = static_cast<unsigned char>(ch);
+    if (byte == '"' || byte == '\\') {
+      *out++ = '\\';
+      *out++ = ch;
+    } else if (byte < 0x20) {
+      out = Append(out, "\\u00");
+      *out++ = kHexDigits[byte >> 4];
+      *out++ = kHexDigits[byte & 0xf];
+    } else {
+      *out++ = ch;
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+AccessLog::~AccessLog() {
+  sample_rate_.store(0, std::memory_order_relaxed);
+  // 写线程退出前会再收集一轮，剩余的记录全部写出
+  writer_.Stop();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool AccessLog::Init(const std::string& file_name, Format format,
+                     int sample_rate) {
+  if (writer_.running()) {
+    return true;
+  }
+  std::filesystem::path dir = std::filesystem::path(file_name).parent_path();
+  if (!dir.empty()) {
+    std::filesystem::create_directories(dir);
+  }
+  fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+             0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  format_ = format;
+  buffers_.set_buffer_size(kThreadBufferSize);
+  staging_ = std::make_unique<char[]>(kStagingSize);
+  writer_.Start(
+      &buffers_, kFlushIntervalMs,
+      [this](const char* data, size_t length) { EmitRecords(data, length); },
+      [this](uint64_t dropped) { WriteDrained(dropped); });
+  sample_rate_.store(std::max(sample_rate, 1), std::memory_order_relaxed);
+  return true;
+}
+
+void AccessLog::Write(const Entry& entry) {
+  ThreadBuffer* buffer = buffers_.Local<AccessLog>();
+  if (buffer == nullptr) {
+    // 线程已退出
+    return;
+  }
+  std::string_view fields[kFieldCount] = {entry.method, entry.target,
+                                          entry.version, entry.referer,
+                                          entry.user_agent};
+  size_t size = sizeof(Record);
+  for (std::string_view& field : fields) {
+    field = field.substr(0, kMaxFieldSize);
+    size += field.size();
+  }
+  char* dest = buffer->Reserve(kMaxRecordSize, [this] { writer_.Wake(); });
+  if (dest == nullptr) {
+    return;
+  }
+
+  auto* record = reinterpret_cast<Record*>(dest);
+  record->time = entry.time;
+  record->latency_us = entry.latency_us;
+  record->bytes = entry.bytes;
+  record->address = entry.address;
+  record->port = entry.port;
+  record->status = static_cast<uint16_t>(entry.status);
+  record->size = static_cast<uint32_t>(size);
+  char* out = dest + sizeof(Record);
+  for (int i = 0; i < kFieldCount; ++i) {
+    record->lengths[i] = static_cast<uint16_t>(fields[i].size());
+    out = Append(out, fields[i]);
+  }
+  // 按 8 字节对齐，下一条记录的头部可以直接访问
+  buffer->Commit((size + 7) & ~static_cast<size_t>(7));
+}
+
+void AccessLog::Flush() { writer_.Flush(); }
+
+void AccessLog::WriteDrained(uint64_t dropped) {
+  WriteStaging();
+  if (dropped > 0) {
+    LOG_WARN("%llu access log entries dropped",
+             static_cast<unsigned long long>(dropped));
+  }
+}
+
+void AccessLog::UpdateTime(time_t second) {
+  struct tm now;
+  localtime_r(&second, &now);
+  if (format_ == Format::kCombined) {
+    time_length_ =
+        strftime(time_text_, sizeof(time_text_), "%d/%b/%Y:%H:%M:%S %z", &now);
+  } else {
+    time_length_ =
+        strftime(time_text_, sizeof(time_text_), "%Y-%m-%dT%H:%M:%S", &now);
+    // %z 输出 +hhmm，RFC 3339 要求扩展格式 +hh:mm
+    char zone[8];
+    if (strftime(zone, sizeof(zone), "%z", &now) == 5) {
+      std::memcpy(zone_text_, zone, 3);
+      zone_text_[3] = ':';
+      std::memcpy(zone_text_ + 4, zone + 3, 3);
+    } else {
+      std::memcpy(zone_text_, "Z", 2);
+    }
+  }
+  second_ = second;
+}
+
+void AccessLog::EmitRecords(const char* data, size_t length) {
+  const char* end = data + length;
+  while (data < end) {
+    const auto* record = reinterpret_cast<const Record*>(data);
+    std::string_view fields[kFieldCount];
+    const char* text = data + sizeof(Record);
+    for (int i = 0; i < kFieldCount; ++i) {
+      fields[i] = std::string_view(text, record->lengths[i]);
+      text += record->lengths[i];
+    }
+    const std::string_view& method = fields[0];
+    const std::string_view& target = fields[1];
+    const std::string_view& version = fields[2];
+    const std::string_view& referer = fields[3];
+    const std::string_view& user_agent = fields[4];
+
+    if (kStagingSize - staging_used_ < kMaxLineSize) {
+      WriteStaging();
+    }
+    if (record->time.tv_sec != second_) {
+      UpdateTime(record->time.tv_sec);
+    }
+    char address[INET_ADDRSTRLEN];
+    struct in_addr addr;
+    addr.s_addr = record->address;
+    inet_ntop(AF_INET, &addr, address, sizeof(address));
+    int64_t latency_us = std::max<int64_t>(record->latency_us, 0);
+
+    char* out = staging_.get() + staging_used_;
+    if (format_ == Format::kCombined) {
+      // 地址 - - [时间] "请求行" 状态码 字节数 "Referer" "User-Agent" 耗时
+      out = Append(out, address);
+      out = Append(out, " - - [");
+      out = Append(out, std::string_view(time_text_, time_length_));
+      out = Append(out, "] \"");
+      if (method.empty()) {
+        *out++ = '-';
+      } else {
+        out = EscapeCombined(out, method);
+        *out++ = ' ';
+        out = EscapeCombined(out, target);
+        *out++ = ' ';
+        out = EscapeCombined(out, version);
+      }
+      out = Append(out, "\" ");
+      out = AppendNumber(out, record->status);
+      *out++ = ' ';
+      out = AppendNumber(out, record->bytes);
+      out = Append(out, " \"");
+      out = EscapeCombined(out, referer);
+      out = Append(out, "\" \"");
+      out = EscapeCombined(out, user_agent);
+      out = Append(out, "\" ");
+      out = AppendNumber(out, latency_us / 1000000);
+      *out++ = '.';
+      int64_t micros = latency_us % 1000000;
+      for (int i = 5; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + micros % 10);
+        micros /= 10;
+      }
+      out += 6;
+    } else {
+      out = Append(out, "{\"time\":\"");
+      out = Append(out, std::string_view(time_text_, time_length_));
+      *out++ = '.';
+      long millis = record->time.tv_nsec / 1000000;
+      *out++ = static_cast<char>('0' + millis / 100);
+      *out++ = static_cast<char>('0' + millis / 10 % 10);
+      *out++ = static_cast<char>('0' + millis % 10);
+      out = Append(out, zone_text_);
+      out = Append(out, "\",\"remote_addr\":\"");
+      out = Append(out, address);
+      out = Append(out, "\",\"remote_port\":");
+      out = AppendNumber(out, ntohs(record->port));
+      out = Append(out, ",\"method\":\"");
+      out = EscapeJson(out, method);
+      out = Append(out, "\",\"path\":\"");
+      out = EscapeJson(out, target);
+      out = Append(out, "\",\"protocol\":\"");
+      out = EscapeJson(out, version);
+      out = Append(out, "\",\"status\":");
+      out = AppendNumber(out, record->status);
+      out = Append(out, ",\"bytes\":");
+      out = AppendNumber(out, record->bytes);
+      out = Append(out, ",\"latency_us\":");
+      out = AppendNumber(out, latency_us);
+      out = Append(out, ",\"referer\":\"");
+      out = EscapeJson(out, referer);
+      out = Append(out, "\",\"user_agent\":\"");
+      out = EscapeJson(out, user_agent);
+      out = Append(out, "\"}");
+    }
+    *out++ = '\n';
+    staging_used_ = static_cast<size_t>(out - staging_.get());
+    data += (record->size + 7) & ~static_cast<uint32_t>(7);
+  }
+}
+
+void AccessLog::WriteStaging() {
+  // 格式化好的行在暂存区中连续存放，一次 write 写出整批
+  const char* data = staging_.get();
+  size_t remaining = staging_used_;
+  while (remaining > 0) {
+    ssize_t written = ::write(fd_, data, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    data += written;
+    remaining -= static_cast<size_t>(written);
+  }
+  staging_used_ = 0;
+}
+
+}  // namespace tinywebserver
@@ -0,0 +1,134 @@
+// Copyright 2025 TinyWebServer
+// 访问日志：每个请求一条，批量写入
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_LOG_ACCESS_LOG_H_
+#define TINYWEBSERVER_LOG_ACCESS_LOG_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "log/thread_buffer.h"
+
+namespace tinywebserver {
+
+// 单例访问日志，记录每个请求的客户端地址、方法、路径、状态码、响应字节数
+// 和耗时。
+//
+// 处理请求的线程只把定长字段和请求行、Referer、User-Agent 复制到自己的
+// ThreadBuffer，不加锁也不格式化；后台写线程在有缓冲区写满或每隔
+// kFlushIntervalMs 时收集所有线程的记录，格式化为 combined 或 JSON lines，
+// 攒成大块后一次写入。可以按 1/N 采样，满负载下也能一直开启。
+// 后台缓冲区尚未写完时新记录被丢弃，丢弃条数写入普通日志。
+class AccessLog {
+ public:
+  // 输出格式
+  enum class Format {
+    kCombined = 1,   // Apache/nginx combined，末尾追加耗时（秒）
+    kJsonLines = 2,  // 每行一个 JSON 对象
+  };
+
+  // 写线程定期收集未写满的缓冲区的间隔
+  static constexpr int kFlushIntervalMs = 100;
+  // 每个线程一块缓冲区的大小，两块轮换使用
+  static constexpr size_t kThreadBufferSize = 256 * 1024;
+  // 每个字符串字段最多记录的字节数，超出部分截断
+  static constexpr size_t kMaxFieldSize = 1024;
+
+  // 一个请求的访问记录，字符串在 Write 返回前有效
+  struct Entry {
+    struct timespec time;          // 响应生成的时刻
+    int64_t latency_us;            // 从开始读取请求到生成响应的耗时
+    uint64_t bytes;                // 响应字节数（含响应头）
+    uint32_t address;              // 客户端 IPv4 地址，网络字节序
+    uint16_t port;                 // 客户端端口，网络字节序
+    int status;
+    std::string_view method;
+    std::string_view target;
+    std::string_view version;
+    std::string_view referer;
+    std::string_view user_agent;
+  };
+
+  // 获取 AccessLog 的单例实例
+  static AccessLog* GetInstance() {
+    static AccessLog instance;
+    return &instance;
+  }
+
+  // 禁用拷贝和移动操作
+  AccessLog(const AccessLog&) = delete;
+  AccessLog& operator=(const AccessLog&) = delete;
+  AccessLog(AccessLog&&) = delete;
+  AccessLog& operator=(AccessLog&&) = delete;
+
+  // 打开访问日志文件并启动写线程。在调用之前访问日志处于关闭状态。
+  // @param file_name 日志文件路径，追加写入
+  // @param format 输出格式
+  // @param sample_rate 每 sample_rate 个请求记录一个，1 表示全部记录
+  // @return 文件打开失败时返回 false
+  bool Init(const std::string& file_name, Format format, int sample_rate);
+
+  // 访问日志是否开启，只有一次 relaxed 读取。
+  static bool IsEnabled() {
+    return sample_rate_.load(std::memory_order_relaxed) > 0;
+  }
+
+  // 按采样率决定是否记录当前请求，每个线程各自计数。
+  static bool Sample() {
+    int rate = sample_rate_.load(std::memory_order_relaxed);
+    if (rate <= 1) {
+      return rate == 1;
+    }
+    thread_local unsigned int counter = 0;
+    return ++counter % static_cast<unsigned int>(rate) == 0;
+  }
+
+  // 追加一条记录到当前线程的缓冲区。
+  void Write(const Entry& entry);
+
+  // 等待此前追加的记录全部写入文件。
+  void Flush();
+
+ private:
+  AccessLog() = default;
+  ~AccessLog();
+
+  // 写线程一轮收集结束：写出暂存区，把丢弃条数写入普通日志。
+  void WriteDrained(uint64_t dropped);
+
+  // 跨秒时重新格式化时间前缀。
+  void UpdateTime(time_t second);
+
+  // 格式化一段缓冲区中的记录，暂存区写满时先写出。
+  void EmitRecords(const char* data, size_t length);
+
+  // 写出暂存区。
+  void WriteStaging();
+
+  // 采样率，0 表示关闭
+  static inline std::atomic<int> sample_rate_{0};
+
+  Format format_{Format::kCombined};
+  int fd_{-1};
+  ThreadBufferRegistry buffers_;
+
+  // 后台写线程
+  ThreadBufferWriter writer_;
+
+  // 以下字段只由写线程访问
+  std::unique_ptr<char[]> staging_;       // 格式化好的日志行
+  size_t staging_used_{0};
+  time_t second_{-1};                     // time_text_ 对应的秒
+  char time_text_[48]{};                  // 当前秒格式化好的时间
+  size_t time_length_{0};
+  char zone_text_[8]{};                   // JSON 时间的时区部分，+hh:mm
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_LOG_ACCESS_LOG_H_
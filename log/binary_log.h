@@ -0,0 +1,80 @@
+// Copyright 2025 TinyWebServer
+// 二进制日志文件格式，日志写线程与 tinylog-decode 共用
+// 遵循 Google C++ 编码规范
+//
+// 文件由连续的条目组成，每个条目以一个标签字节开头：
+//   'M' "TINYLOG" 版本号  每次打开文件时写入，解码端遇到后清空调用点定义并把
+//                          时间基准归零，因此多次运行追加到同一文件也能解码
+//   'D' 定义一个调用点：varint 格式 ID、级别字节、varint 行号，
+//       以及源文件名、参数类型签名和格式串三个字符串（varint 长度 + 内容）
+//   'L' 一条日志：varint 格式 ID、zigzag varint 时间差（纳秒，相对同一文件中
+//       上一条日志，首条相对 0），随后是按类型签名排列的参数原始字节
+// 参数按运行平台的原生字节序写入，解码需在相同字长和字节序的机器上进行。
+//
+// 参数类型签名中每个字符对应一个参数：
+//   b bool  c char  C unsigned char  h int16  H uint16  i int32  u uint32
+//   l int64  U uint64  f float  d double  D long double  p 指针  n nullptr
+//   s C 字符串  v std::string_view（两者都是 uint32 长度 + 内容 + '\0'）
+// 枚举按其底层整数类型记录。
+
+#ifndef TINYWEBSERVER_LOG_BINARY_LOG_H_
+#define TINYWEBSERVER_LOG_BINARY_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tinywebserver {
+namespace binary_log {
+
+// 文件头条目，含标签字节
+inline constexpr char kMagic[] = {'M', 'T', 'I', 'N', 'Y', 'L', 'O', 'G', 1};
+
+inline constexpr char kTagMagic = 'M';
+inline constexpr char kTagDefine = 'D';
+inline constexpr char kTagLog = 'L';
+
+// 一个 varint 的最大字节数
+inline constexpr size_t kMaxVarint = 10;
+
+// 写入 7 位一组、低位在前的 varint
+// @param out 至少 kMaxVarint 字节
+// @return 写入的字节数
+inline size_t PutVarint(char* out, uint64_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out[n++] = static_cast<char>(value);
+  return n;
+}
+
+// 读取一个 varint 并前移 *in
+// @return 数据不完整或超过 64 位时返回 false
+inline bool GetVarint(const char** in, const char* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *in < end; shift += 7) {
+    auto byte = static_cast<uint8_t>(*(*in)++);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// 有符号数映射为无符号数，绝对值小的数编码后也短
+inline uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // namespace binary_log
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_LOG_BINARY_LOG_H_
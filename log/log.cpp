@@ -3,201 +3,435 @@
 
 #include "log.h"
 
-#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <climits>
 #include <cstring>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <iterator>
+
+#include "log/binary_log.h"
 
 namespace tinywebserver {
 
+namespace {
+
+// 暂存区的最小大小，写满后写出一次
+constexpr size_t kStagingSize = 256 * 1024;
+
+// 每个线程一份时间前缀缓存，平凡析构，线程退出过程中仍可使用
+TimestampCache& ThreadTimestamp() {
+  thread_local TimestampCache cache;
+  return cache;
+}
+
+// 写入 varint 长度和字符串内容
+// @return 下一个写入位置
+char* PutString(char* out, const char* str) {
+  size_t length = std::strlen(str);
+  out += binary_log::PutVarint(out, length);
+  std::memcpy(out, str, length);
+  return out + length;
+}
+
+}  // namespace
+
+namespace log_internal {
+
+int FormatV(char* buf, size_t size, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = std::vsnprintf(buf, size, format, args);
+  va_end(args);
+  return n;
+}
+
+}  // namespace log_internal
+
 Logger::Logger()
     : split_lines_(0),
       log_buf_size_(0),
       count_(0),
-      today_(0),
+      today_{},
+      fd_(-1),
       is_async_(false),
-      close_log_(0) {}
+      binary_(false) {}
 
 Logger::~Logger() {
-  if (fp_) {
-    std::fflush(fp_.get());
-  }
-  
-  if (async_thread_ && async_thread_->joinable()) {
-    // 通过推入空字符串来通知异步线程停止
-    if (log_queue_) {
-      log_queue_->Push("");
-    }
-    async_thread_->join();
+  // 写线程退出前会再收集一轮，剩余的日志全部写出
+  writer_.Stop();
+  level_.store(static_cast<int>(LogLevel::kOff), std::memory_order_relaxed);
+  if (fd_ >= 0) {
+    close(fd_);
   }
 }
 
 bool Logger::Init(const std::string& file_name, int close_log,
-                  int log_buf_size, int split_lines, int max_queue_size) {
-  // 如果指定了队列大小，设置异步模式
-  if (max_queue_size >= 1) {
-    is_async_ = true;
-    log_queue_ = std::make_unique<BlockQueue<std::string>>(max_queue_size);
-    
-    // 创建异步写入线程
-    async_thread_ = std::make_unique<std::thread>([this]() {
-      this->AsyncWriteLog();
-    });
-  }
-
-  close_log_ = close_log;
-  log_buf_size_ = log_buf_size;
-  buf_ = std::make_unique<char[]>(log_buf_size);
-  std::memset(buf_.get(), '\0', log_buf_size);
-  split_lines_ = split_lines;
-
-  // 获取当前时间
-  time_t t = time(nullptr);
-  struct tm* sys_tm = localtime(&t);
-  struct tm my_tm = *sys_tm;
+                  int log_buf_size, int split_lines, int max_queue_size,
+                  LogLevel level, bool binary) {
+  log_buf_size_ = std::max(log_buf_size, static_cast<int>(2 * kPrefixSize));
+  split_lines_ = std::max(split_lines, 1);
+  binary_ = binary;
+  buffers_.set_buffer_size(
+      std::max(kThreadBufferSize, 2 * max_record_size()));
+  staging_size_ = std::max(kStagingSize, 2 * max_record_size());
+  staging_ = std::make_unique<char[]>(staging_size_);
+  immediate_ = std::make_unique<char[]>(max_record_size());
 
   // 解析文件路径
   std::filesystem::path file_path(file_name);
-  std::filesystem::path parent_path = file_path.parent_path();
-  std::filesystem::path filename = file_path.filename();
-
-  // 生成带日期的日志文件名
-  std::ostringstream log_full_name;
-  if (parent_path.empty()) {
-    log_full_name << my_tm.tm_year + 1900 << "_"
-                  << std::setfill('0') << std::setw(2) << my_tm.tm_mon + 1 << "_"
-                  << std::setfill('0') << std::setw(2) << my_tm.tm_mday << "_"
-                  << filename.string();
-    log_name_ = filename;
-  } else {
-    log_full_name << parent_path.string() << "/"
-                  << my_tm.tm_year + 1900 << "_"
-                  << std::setfill('0') << std::setw(2) << my_tm.tm_mon + 1 << "_"
-                  << std::setfill('0') << std::setw(2) << my_tm.tm_mday << "_"
-                  << filename.string();
-    dir_name_ = parent_path;
-    log_name_ = filename;
-    
+  dir_name_ = file_path.parent_path();
+  log_name_ = file_path.filename();
+  if (!dir_name_.empty()) {
     // 如果目录不存在则创建
-    std::filesystem::create_directories(parent_path);
+    std::filesystem::create_directories(dir_name_);
   }
 
-  today_ = my_tm.tm_mday;
-
-  // 打开日志文件
-  fp_.reset(std::fopen(log_full_name.str().c_str(), "a"));
-  if (!fp_) {
+  // 打开当天的日志文件
+  time_t t = time(nullptr);
+  localtime_r(&t, &today_);
+  if (!OpenLogFile(today_, 0)) {
     return false;
   }
 
+  // 如果指定了队列大小，设置异步模式并创建写线程
+  if (max_queue_size >= 1) {
+    is_async_ = true;
+    writer_.Start(
+        &buffers_, kFlushIntervalMs,
+        [this](const char* data, size_t length) { EmitDrained(data, length); },
+        [this](uint64_t dropped) { WriteDrained(dropped); });
+  }
+
+  level_.store(close_log != 0 ? static_cast<int>(LogLevel::kOff)
+                               : static_cast<int>(level),
+               std::memory_order_relaxed);
   return true;
 }
 
-void Logger::WriteLog(LogLevel level, const char* format, ...) {
-  struct timeval now = {0, 0};
-  gettimeofday(&now, nullptr);
-  time_t t = now.tv_sec;
-  struct tm* sys_tm = localtime(&t);
-  struct tm my_tm = *sys_tm;
+char* Logger::InitRecord(char* dest, LogSite* site,
+                         const log_internal::ArgsInfo* args, size_t size) {
+  auto* header = reinterpret_cast<log_internal::RecordHeader*>(dest);
+  header->args = args;
+  header->site = site;
+  clock_gettime(CLOCK_REALTIME, &header->time);
+  header->size = static_cast<uint32_t>(size);
+  return dest + sizeof(log_internal::RecordHeader);
+}
 
-  // 获取级别字符串
-  const char* level_str = GetLevelString(level);
+char* Logger::BeginRecord(ThreadBuffer* buffer, LogSite* site,
+                          const log_internal::ArgsInfo* args, size_t size) {
+  // 记录长度向上对齐到 8 字节，多留出对齐的余量
+  char* dest =
+      buffer->Reserve(max_record_size() + 8, [this] { writer_.Wake(); });
+  if (dest == nullptr) {
+    return nullptr;
+  }
+  return InitRecord(dest, site, args, size);
+}
 
-  // 处理日志切分
-  std::unique_lock<std::mutex> lock(mutex_);
-  count_++;
-
-  if (today_ != my_tm.tm_mday || count_ % split_lines_ == 0) {
-    std::fflush(fp_.get());
-    fp_.reset();
-
-    std::ostringstream new_log;
-    std::ostringstream tail;
-    tail << my_tm.tm_year + 1900 << "_"
-         << std::setfill('0') << std::setw(2) << my_tm.tm_mon + 1 << "_"
-         << std::setfill('0') << std::setw(2) << my_tm.tm_mday << "_";
-
-    if (today_ != my_tm.tm_mday) {
-      if (dir_name_.empty()) {
-        new_log << tail.str() << log_name_.string();
-      } else {
-        new_log << dir_name_.string() << "/" << tail.str() << log_name_.string();
-      }
-      today_ = my_tm.tm_mday;
-      count_ = 0;
+void Logger::CommitRecord(ThreadBuffer* buffer) {
+  const auto* header =
+      reinterpret_cast<const log_internal::RecordHeader*>(buffer->Tail());
+  buffer->Commit(log_internal::AlignRecord(header->size));
+}
+
+char* Logger::BeginImmediate(LogSite* site, const log_internal::ArgsInfo* args,
+                             size_t size) {
+  return InitRecord(immediate_.get(), site, args, size);
+}
+
+void Logger::EndImmediate() {
+  const auto* header =
+      reinterpret_cast<const log_internal::RecordHeader*>(immediate_.get());
+  RotateByDay(LocalTime(header->time.tv_sec));
+  EmitRecords(immediate_.get(), header->size);
+  WritePending();
+}
+
+LogSite& Logger::TruncatedSite(LogLevel level) {
+  static LogSite sites[] = {
+      {LogLevel::kDebug, "%.*s", __FILE__, __LINE__, 0, 0},
+      {LogLevel::kInfo, "%.*s", __FILE__, __LINE__, 0, 0},
+      {LogLevel::kWarn, "%.*s", __FILE__, __LINE__, 0, 0},
+      {LogLevel::kError, "%.*s", __FILE__, __LINE__, 0, 0},
+  };
+  return sites[std::min(static_cast<size_t>(level), std::size(sites) - 1)];
+}
+
+void Logger::Flush() { writer_.Flush(); }
+
+void Logger::EmitDrained(const char* data, size_t length) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // 只需要秒级时间判断日期，粗粒度时钟足够且更便宜
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME_COARSE, &now);
+  RotateByDay(LocalTime(now.tv_sec));
+  EmitRecords(data, length);
+}
+
+void Logger::WriteDrained(uint64_t dropped) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // 没有新日志时也按日期切换文件
+  struct timespec pass_time;
+  clock_gettime(CLOCK_REALTIME_COARSE, &pass_time);
+  RotateByDay(LocalTime(pass_time.tv_sec));
+
+  if (dropped > 0) {
+    // 丢弃计数作为一条普通记录输出，两种文件格式都适用
+    static LogSite dropped_site{LogLevel::kWarn, "%llu log messages dropped",
+                                __FILE__, __LINE__, 0, 0};
+    using Count = unsigned long long;
+    alignas(log_internal::RecordHeader)
+        char record[sizeof(log_internal::RecordHeader) + sizeof(Count)];
+    char* out = InitRecord(record, &dropped_site,
+                           &log_internal::kArgsInfo<Count>, sizeof(record));
+    reinterpret_cast<log_internal::RecordHeader*>(record)->time = pass_time;
+    log_internal::Encode(out, static_cast<Count>(dropped));
+    EmitRecords(record, sizeof(record));
+  }
+  WritePending();
+}
+
+void Logger::EmitRecords(const char* data, size_t length) {
+  const char* end = data + length;
+  while (data < end) {
+    const auto* header =
+        reinterpret_cast<const log_internal::RecordHeader*>(data);
+    if (binary_) {
+      EmitBinary(*header);
     } else {
-      if (dir_name_.empty()) {
-        new_log << tail.str() << log_name_.string() << "." 
-                << count_ / split_lines_;
-      } else {
-        new_log << dir_name_.string() << "/" << tail.str() 
-                << log_name_.string() << "." << count_ / split_lines_;
-      }
+      EmitText(*header);
     }
-    
-    fp_.reset(std::fopen(new_log.str().c_str(), "a"));
+    data += log_internal::AlignRecord(header->size);
   }
+}
 
-  lock.unlock();
-
-  // 格式化日志消息
-  va_list valst;
-  va_start(valst, format);
-
-  std::string log_str;
-  lock.lock();
+void Logger::EmitText(const log_internal::RecordHeader& header) {
+  char* line = StagingSpace(max_record_size());
+  int n = FormatPrefix(line, header.site->level, header.time);
+  size_t room = max_message_size();
+  int m = header.args->formatter(
+      line + n, room, header.site->format,
+      reinterpret_cast<const char*>(&header) + sizeof(header));
+  // 内容超长时截断，始终以换行结尾
+  size_t message_length =
+      m < 0 ? 0 : std::min(static_cast<size_t>(m), room - 1);
+  line[static_cast<size_t>(n) + message_length] = '\n';
+  size_t line_length = static_cast<size_t>(n) + message_length + 1;
+  staging_used_ += line_length;
+  AppendChunk(line, line_length);
+}
 
-  // 写入时间戳和级别
-  int n = std::snprintf(buf_.get(), 48, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s ",
-                        my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday,
-                        my_tm.tm_hour, my_tm.tm_min, my_tm.tm_sec, 
-                        now.tv_usec, level_str);
+void Logger::EmitBinary(const log_internal::RecordHeader& header) {
+  // 按条数切分文件
+  if (++count_ % split_lines_ == 0) {
+    WritePending();
+    OpenLogFile(today_, count_ / split_lines_);
+  }
+  LogSite* site = header.site;
+  if (site->generation != file_generation_) {
+    if (site->id == 0) {
+      site->id = ++site_count_;
+    }
+    site->generation = file_generation_;
+    EmitDefinition(*site, header.args->signature);
+  }
 
-  // 写入实际的日志内容
-  int m = std::vsnprintf(buf_.get() + n, log_buf_size_ - n - 1, format, valst);
-  buf_[n + m] = '\n';
-  buf_[n + m + 1] = '\0';
-  log_str = buf_.get();
+  size_t args_length = header.size - sizeof(header);
+  char* entry = StagingSpace(1 + 2 * binary_log::kMaxVarint + args_length);
+  char* out = entry;
+  *out++ = binary_log::kTagLog;
+  out += binary_log::PutVarint(out, site->id);
+  int64_t time = static_cast<int64_t>(header.time.tv_sec) * 1000000000 +
+                 header.time.tv_nsec;
+  out += binary_log::PutVarint(out, binary_log::ZigZag(time - last_time_));
+  last_time_ = time;
+  std::memcpy(out, reinterpret_cast<const char*>(&header) + sizeof(header),
+              args_length);
+  out += args_length;
+  size_t length = static_cast<size_t>(out - entry);
+  staging_used_ += length;
+  PushPending(entry, length);
+}
 
-  lock.unlock();
+void Logger::EmitDefinition(const LogSite& site, const char* signature) {
+  size_t size = 1 + 3 * binary_log::kMaxVarint + 1 + std::strlen(site.file) +
+                std::strlen(signature) + std::strlen(site.format);
+  char* entry = StagingSpace(size);
+  char* out = entry;
+  *out++ = binary_log::kTagDefine;
+  out += binary_log::PutVarint(out, site.id);
+  *out++ = static_cast<char>(site.level);
+  out += binary_log::PutVarint(out, static_cast<uint64_t>(site.line));
+  out = PutString(out, site.file);
+  out = PutString(out, signature);
+  out = PutString(out, site.format);
+  size_t length = static_cast<size_t>(out - entry);
+  staging_used_ += length;
+  PushPending(entry, length);
+}
 
-  // 写入异步队列或直接写入文件
-  if (is_async_ && log_queue_ && !log_queue_->Full()) {
-    log_queue_->Push(log_str);
-  } else {
-    lock.lock();
-    std::fputs(log_str.c_str(), fp_.get());
-    lock.unlock();
+char* Logger::StagingSpace(size_t size) {
+  // 待写列表为空时暂存区没有被引用，可以从头使用
+  if (pending_.empty()) {
+    staging_used_ = 0;
+  } else if (staging_size_ - staging_used_ < size) {
+    WritePending();
+    staging_used_ = 0;
   }
+  return staging_.get() + staging_used_;
+}
 
-  va_end(valst);
+void Logger::AppendChunk(const char* data, size_t length) {
+  // 逐行计数，在第 split_lines_ 的整数倍行之前切换到新文件
+  const char* start = data;
+  const char* end = data + length;
+  for (const char* p = data; p < end;) {
+    const char* line_end =
+        static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    if (++count_ % split_lines_ == 0) {
+      if (p > start) {
+        PushPending(start, static_cast<size_t>(p - start));
+      }
+      WritePending();
+      OpenLogFile(today_, count_ / split_lines_);
+      start = p;
+    }
+    p = line_end == nullptr ? end : line_end + 1;
+  }
+  if (end > start) {
+    PushPending(start, static_cast<size_t>(end - start));
+  }
 }
 
-void Logger::Flush() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (fp_) {
-    std::fflush(fp_.get());
+void Logger::PushPending(const char* data, size_t length) {
+  // 与上一段在暂存区中相邻时合并为一段
+  if (!pending_.empty()) {
+    struct iovec& last = pending_.back();
+    if (static_cast<char*>(last.iov_base) + last.iov_len == data) {
+      last.iov_len += length;
+      return;
+    }
   }
+  pending_.push_back({const_cast<char*>(data), length});
 }
 
-void Logger::AsyncWriteLog() {
-  std::string single_log;
-  // 从队列中弹出日志并写入文件
-  while (log_queue_->Pop(single_log)) {
-    // 空字符串表示关闭信号
-    if (single_log.empty()) {
+void Logger::WritePending() {
+  size_t index = 0;
+  while (index < pending_.size()) {
+    int count = static_cast<int>(std::min<size_t>(pending_.size() - index,
+                                                  IOV_MAX));
+    ssize_t written = writev(fd_, &pending_[index], count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
       break;
     }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (fp_) {
-      std::fputs(single_log.c_str(), fp_.get());
+    // 跳过已写完的段，部分写入的段调整起点后继续
+    size_t remaining = static_cast<size_t>(written);
+    while (index < pending_.size() && remaining >= pending_[index].iov_len) {
+      remaining -= pending_[index].iov_len;
+      ++index;
+    }
+    if (remaining > 0) {
+      pending_[index].iov_base =
+          static_cast<char*>(pending_[index].iov_base) + remaining;
+      pending_[index].iov_len -= remaining;
     }
   }
+  pending_.clear();
+}
+
+void Logger::RotateByDay(const struct tm& now) {
+  if (now.tm_yday == today_.tm_yday && now.tm_year == today_.tm_year) {
+    return;
+  }
+  WritePending();
+  today_ = now;
+  count_ = 0;
+  OpenLogFile(today_, 0);
+}
+
+bool Logger::OpenLogFile(const struct tm& day, long long part) {
+  // 生成带日期的日志文件名：[目录/]YYYY_MM_DD_文件名[.序号][.tlog]
+  char date[32];
+  std::snprintf(date, sizeof(date), "%d_%02d_%02d_", day.tm_year + 1900,
+                day.tm_mon + 1, day.tm_mday);
+  std::string path = dir_name_.empty() ? std::string()
+                                       : dir_name_.string() + "/";
+  path += date;
+  path += log_name_.string();
+  if (part > 0) {
+    path += "." + std::to_string(part);
+  }
+  if (binary_) {
+    path += ".tlog";
+  }
+
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    // 打开失败时继续写原文件
+    return false;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = fd;
+  if (binary_) {
+    // 调用方已写出待写列表，文件头是新文件的第一个条目；
+    // 格式 ID 不变，但定义要在新文件中重新写入，时间差从 0 开始
+    PushPending(binary_log::kMagic, sizeof(binary_log::kMagic));
+    ++file_generation_;
+    last_time_ = 0;
+  }
+  return true;
+}
+
+const struct tm& TimestampCache::LocalTime(time_t second) {
+  if (second != second_) {
+    localtime_r(&second, &tm_);
+    int n = std::snprintf(text_, sizeof(text_), "%d-%02d-%02d %02d:%02d:%02d.",
+                          tm_.tm_year + 1900, tm_.tm_mon + 1, tm_.tm_mday,
+                          tm_.tm_hour, tm_.tm_min, tm_.tm_sec);
+    length_ = std::min(static_cast<size_t>(std::max(n, 0)), sizeof(text_) - 7);
+    second_ = second;
+  }
+  return tm_;
+}
+
+size_t TimestampCache::Format(const struct timespec& time, char* buf) {
+  LocalTime(time.tv_sec);
+  std::memcpy(buf, text_, length_);
+  // 同一秒内只改写 6 位微秒
+  long usec = time.tv_nsec / 1000;
+  for (size_t i = 6; i > 0; --i) {
+    buf[length_ + i - 1] = static_cast<char>('0' + usec % 10);
+    usec /= 10;
+  }
+  return length_ + 6;
+}
+
+int Logger::FormatPrefix(char* buf, LogLevel level,
+                         const struct timespec& time) {
+  size_t n = ThreadTimestamp().Format(time, buf);
+  const char* level_str = GetLevelString(level);
+  size_t level_length = std::strlen(level_str);
+  buf[n] = ' ';
+  std::memcpy(buf + n + 1, level_str, level_length);
+  buf[n + 1 + level_length] = ' ';
+  return static_cast<int>(n + level_length + 2);
+}
+
+const struct tm& Logger::LocalTime(time_t second) {
+  return ThreadTimestamp().LocalTime(second);
 }
 
-const char* Logger::GetLevelString(LogLevel level) const {
+const char* Logger::GetLevelString(LogLevel level) {
   switch (level) {
     case LogLevel::kDebug:
       return "[DEBUG]:";
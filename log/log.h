@@ -5,17 +5,30 @@
 #ifndef TINYWEBSERVER_LOG_LOG_H_
 #define TINYWEBSERVER_LOG_LOG_H_
 
-#include <cstdarg>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
-#include <fstream>
-#include <iostream>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "log/thread_buffer.h"
 
-#include "block_queue.h"
+// 编译期日志级别下限 (0=debug, 1=info, 2=warn, 3=error, 4=全部关闭)，
+// 低于该级别的日志调用不生成任何代码。由 CMake 的 LOG_MIN_LEVEL 设置。
+#ifndef TINYWEBSERVER_LOG_MIN_LEVEL
+#define TINYWEBSERVER_LOG_MIN_LEVEL 0
+#endif
 
 namespace tinywebserver {
 
@@ -24,13 +37,236 @@ enum class LogLevel {
   kDebug = 0,
   kInfo = 1,
   kWarn = 2,
-  kError = 3
+  kError = 3,
+  kOff = 4
+};
+
+// 该级别的日志调用是否编译进程序
+template <LogLevel kLevel>
+inline constexpr bool kLogLevelCompiled =
+    static_cast<int>(kLevel) >= TINYWEBSERVER_LOG_MIN_LEVEL;
+
+// 一处日志调用，日志宏为每个调用点生成一个静态实例。
+// 二进制格式下日志只记录调用点的格式 ID，格式串等在文件中只定义一次。
+struct LogSite {
+  LogLevel level;
+  const char* format;     // 字符串字面量
+  const char* file;
+  int line;
+  // 以下字段由 Logger 在 mutex_ 内维护
+  uint32_t id;            // 格式 ID，0 表示尚未分配
+  uint64_t generation;    // 已写入定义的日志文件代数
+};
+
+namespace log_internal {
+
+// 写线程格式化一条延迟记录的函数，按参数类型实例化
+// @return vsnprintf 的返回值
+using Formatter = int (*)(char* buf, size_t size, const char* format,
+                          const char* args);
+
+// 一组参数类型的格式化函数和类型签名（见 binary_log.h）
+struct ArgsInfo {
+  Formatter formatter;
+  const char* signature;
+};
+
+// 一条日志记录的头部，后面紧跟编码后的参数
+struct RecordHeader {
+  const ArgsInfo* args;
+  LogSite* site;          // 静态存储，写线程处理时仍然有效
+  struct timespec time;   // 调用时刻
+  uint32_t size;          // 整条记录的字节数
+};
+
+// @return 下一条记录的偏移，记录按 8 字节对齐以便直接访问头部
+inline size_t AlignRecord(size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// vsnprintf 的可变参数包装
+int FormatV(char* buf, size_t size, const char* format, ...);
+
+template <typename T>
+inline constexpr bool kIsCString =
+    std::is_same_v<T, const char*> || std::is_same_v<T, char*>;
+
+// 可以延迟格式化的参数类型：按值复制，C 字符串和 string_view 复制内容
+template <typename T>
+inline constexpr bool kDeferrable =
+    std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> ||
+    std::is_null_pointer_v<T> || std::is_same_v<T, std::string_view>;
+
+// @return 参数编码后的字节数
+template <typename T>
+size_t EncodedSize(const T& value) {
+  if constexpr (kIsCString<T>) {
+    return sizeof(uint32_t) + std::strlen(value ? value : "(null)") + 1;
+  } else if constexpr (std::is_same_v<T, std::string_view>) {
+    return sizeof(uint32_t) + value.size() + 1;
+  } else {
+    return sizeof(T);
+  }
+}
+
+inline char* EncodeBytes(char* out, const char* data, size_t size) {
+  uint32_t length = static_cast<uint32_t>(size);
+  std::memcpy(out, &length, sizeof(length));
+  std::memcpy(out + sizeof(length), data, size);
+  out[sizeof(length) + size] = '\0';
+  return out + sizeof(length) + size + 1;
+}
+
+// 编码一个参数：字符串为长度、内容和结尾的 '\0'，其他类型按值复制
+// @return 下一个参数的写入位置
+template <typename T>
+char* Encode(char* out, const T& value) {
+  if constexpr (kIsCString<T>) {
+    const char* str = value ? value : "(null)";
+    return EncodeBytes(out, str, std::strlen(str));
+  } else if constexpr (std::is_same_v<T, std::string_view>) {
+    return EncodeBytes(out, value.data(), value.size());
+  } else {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+  }
+}
+
+// 解码一个参数，字符串指向记录内的副本
+template <typename T>
+auto Decode(const char** in) {
+  if constexpr (kIsCString<T> || std::is_same_v<T, std::string_view>) {
+    uint32_t length;
+    std::memcpy(&length, *in, sizeof(length));
+    const char* str = *in + sizeof(length);
+    *in = str + length + 1;
+    if constexpr (kIsCString<T>) {
+      return str;
+    } else {
+      return std::string_view(str, length);
+    }
+  } else {
+    T value;
+    std::memcpy(&value, *in, sizeof(T));
+    *in += sizeof(T);
+    return value;
+  }
+}
+
+// string_view 展开为 "%.*s" 需要的长度和指针两个参数
+template <typename T>
+auto PrintfArgs(const T& value) {
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    return std::make_tuple(static_cast<int>(value.size()), value.data());
+  } else {
+    return std::make_tuple(value);
+  }
+}
+
+// 按 printf 格式化，string_view 参数对应 "%.*s"
+template <typename... Args>
+int Format(char* buf, size_t size, const char* format, const Args&... args) {
+  return std::apply(
+      [&](const auto&... expanded) {
+        return FormatV(buf, size, format, expanded...);
+      },
+      std::tuple_cat(PrintfArgs(args)...));
+}
+
+// 写线程解码一条记录的参数并格式化
+template <typename... Args>
+int FormatRecord(char* buf, size_t size, const char* format,
+                 const char* args) {
+  // 花括号初始化保证按参数顺序依次解码
+  std::tuple<decltype(Decode<Args>(&args))...> values{Decode<Args>(&args)...};
+  return std::apply(
+      [&](const auto&... decoded) {
+        return Format(buf, size, format, decoded...);
+      },
+      values);
+}
+
+// @return 参数类型在二进制格式签名中的字符
+template <typename T>
+constexpr char TypeCode() {
+  if constexpr (kIsCString<T>) {
+    return 's';
+  } else if constexpr (std::is_same_v<T, std::string_view>) {
+    return 'v';
+  } else if constexpr (std::is_null_pointer_v<T>) {
+    return 'n';
+  } else if constexpr (std::is_pointer_v<T>) {
+    return 'p';
+  } else if constexpr (std::is_enum_v<T>) {
+    return TypeCode<std::underlying_type_t<T>>();
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return 'b';
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return sizeof(T) == 4 ? 'f' : sizeof(T) == 8 ? 'd' : 'D';
+  } else if constexpr (sizeof(T) == 1) {
+    return std::is_signed_v<T> ? 'c' : 'C';
+  } else if constexpr (sizeof(T) == 2) {
+    return std::is_signed_v<T> ? 'h' : 'H';
+  } else if constexpr (sizeof(T) == 4) {
+    return std::is_signed_v<T> ? 'i' : 'u';
+  } else {
+    static_assert(sizeof(T) == 8, "unsupported integer size");
+    return std::is_signed_v<T> ? 'l' : 'U';
+  }
+}
+
+template <typename... Args>
+inline constexpr char kSignature[] = {TypeCode<Args>()..., '\0'};
+
+template <typename... Args>
+inline constexpr ArgsInfo kArgsInfo{&FormatRecord<Args...>,
+                                    kSignature<Args...>};
+
+}  // namespace log_internal
+
+// 按秒缓存的日志时间前缀。localtime_r 会加 glibc 的锁并可能重新读取时区，
+// 同一秒内的日志复用上次格式化好的 "YYYY-MM-DD HH:MM:SS."，只改写微秒。
+// 非线程安全，每个线程各用一个实例。
+class TimestampCache {
+ public:
+  // 时间前缀的最大长度
+  static constexpr size_t kMaxLength = 40;
+
+  // @return second 对应的本地时间，跨秒时重新计算
+  const struct tm& LocalTime(time_t second);
+
+  // 写入 "YYYY-MM-DD HH:MM:SS.uuuuuu"，不含结尾的 '\0'。
+  // @param buf 至少 kMaxLength 字节
+  // @return 写入的字节数
+  size_t Format(const struct timespec& time, char* buf);
+
+ private:
+  time_t second_{-1};
+  struct tm tm_{};
+  char text_[kMaxLength]{};  // 当前秒的 "YYYY-MM-DD HH:MM:SS."
+  size_t length_{0};
 };
 
 // 单例日志类，支持同步和异步日志记录。
 // 线程安全，支持基于日期和行数的自动日志文件切分。
+//
+// 异步模式下每个线程把日志追加到自己的一对缓冲区（前台/后台）：
+// 写满前台缓冲区后交给后台写线程并切换到另一块，追加过程不加锁。
+// 追加的是调用时刻、格式串和按值复制的参数，vsnprintf 和时间格式化
+// 都在写线程上完成。写线程在有缓冲区写满或每隔 kFlushIntervalMs 时收集
+// 所有线程的数据，批量写入文件。后台缓冲区尚未写完时新的日志被丢弃并计数。
+//
+// 二进制格式下写线程不做任何格式化，只写出调用点的格式 ID、时间差和参数
+// 原始字节（格式见 binary_log.h），由 tinylog-decode 离线还原为文本。
 class Logger {
  public:
+  // 写线程定期收集未写满的缓冲区的间隔
+  static constexpr int kFlushIntervalMs = 100;
+  // 每个线程一块缓冲区的最小大小，两块轮换使用
+  static constexpr size_t kThreadBufferSize = 64 * 1024;
+  // 时间戳与级别前缀的最大长度
+  static constexpr size_t kPrefixSize = 64;
+
   // 获取 Logger 的单例实例
   static Logger* GetInstance() {
     static Logger instance;
@@ -43,96 +279,225 @@ class Logger {
   Logger(Logger&&) = delete;
   Logger& operator=(Logger&&) = delete;
 
-  // 使用配置参数初始化日志系统。
+  // 使用配置参数初始化日志系统。在调用之前日志处于关闭状态。
   // @param file_name 日志文件路径
   // @param close_log 禁用日志标志 (0 = 启用, 1 = 禁用)
-  // @param log_buf_size 日志缓冲区大小（字节）
+  // @param log_buf_size 单条日志的最大长度（字节）
   // @param split_lines 文件切分前每个日志文件的最大行数
-  // @param max_queue_size 异步队列大小 (0 = 同步模式, >0 = 异步模式)
+  // @param max_queue_size 0 = 同步模式, >0 = 异步模式
+  // @param level 运行时级别门限，低于该级别的日志被忽略
+  // @param binary 写二进制格式的 .tlog 文件，用 tinylog-decode 还原；
+  //               此时 split_lines 按日志条数切分
   // @return 如果初始化成功返回 true，否则返回 false
   bool Init(const std::string& file_name, int close_log,
             int log_buf_size = 8192, int split_lines = 5000000,
-            int max_queue_size = 0);
+            int max_queue_size = 0, LogLevel level = LogLevel::kInfo,
+            bool binary = false);
 
-  // 写入指定级别和格式的日志消息。
-  // @param level 日志级别 (debug, info, warn, error)
-  // @param format Printf 风格的格式字符串
-  // @param ... 格式字符串的可变参数
-  void WriteLog(LogLevel level, const char* format, ...);
+  // 写入一条日志。参数必须是算术类型、指针或 std::string_view；
+  // C 字符串和 string_view 的内容会被复制，"%.*s" 直接传 std::string_view。
+  // 格式化推迟到写线程（二进制格式下推迟到解码时）。
+  // @param site 调用点，包含级别和 Printf 风格的格式字符串
+  // @param args 格式字符串的参数
+  template <typename... Args>
+  void Log(LogSite& site, Args... args);
 
-  // 将日志缓冲区刷新到磁盘。
+  // 等待此前写入的日志全部落到文件。同步模式下每条日志直接写入，无需刷新。
   void Flush();
 
+  // 运行时级别门限检查，只有一次 relaxed 读取。
+  static bool ShouldLog(LogLevel level) {
+    return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+  }
+
+  // 修改运行时级别门限，对所有线程随后的日志调用生效。
+  void set_level(LogLevel level) {
+    level_.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+
   // 检查日志是否被禁用。
-  bool IsLogClosed() const { return close_log_ != 0; }
+  bool IsLogClosed() const { return !ShouldLog(LogLevel::kError); }
+
+  // 获取日志级别的字符串表示，如 "[INFO]:"。
+  static const char* GetLevelString(LogLevel level);
 
  private:
   Logger();
   ~Logger();
 
-  // 异步日志写入线程函数。
-  void AsyncWriteLog();
+  // 一条记录（含头部）的最大长度
+  size_t max_record_size() const { return static_cast<size_t>(log_buf_size_); }
+
+  // 单条日志内容（不含时间前缀和换行）的最大长度
+  size_t max_message_size() const { return max_record_size() - kPrefixSize; }
+
+  // 填写记录头部，时间取当前时刻。
+  // @return 参数的写入位置
+  static char* InitRecord(char* dest, LogSite* site,
+                          const log_internal::ArgsInfo* args, size_t size);
+
+  // 在线程缓冲区中开始一条记录并填好头部。
+  // @param size 记录的字节数（含头部），不超过 max_record_size()
+  // @return 参数的写入位置，两块缓冲区都满时返回 nullptr
+  char* BeginRecord(ThreadBuffer* buffer, LogSite* site,
+                    const log_internal::ArgsInfo* args, size_t size);
+
+  // 提交 BeginRecord 开始的记录，写线程此后可见。
+  void CommitRecord(ThreadBuffer* buffer);
+
+  // 在调用线程上直接写一条日志：在 immediate_ 中开始记录，需持有 mutex_。
+  // @return 参数的写入位置
+  char* BeginImmediate(LogSite* site, const log_internal::ArgsInfo* args,
+                       size_t size);
+
+  // 写出 BeginImmediate 开始的记录。
+  void EndImmediate();
+
+  // 参数过长的日志格式化后截断，改用此调用点按 "%.*s" 记录
+  static LogSite& TruncatedSite(LogLevel level);
+
+  // 写线程收集到的一段记录：日期变化时先切换文件，再输出到待写列表。
+  void EmitDrained(const char* data, size_t length);
+
+  // 写线程一轮收集结束：输出丢弃计数并写出待写列表。
+  void WriteDrained(uint64_t dropped);
+
+  // 按文件格式输出一段缓冲区中的记录并加入待写列表。
+  void EmitRecords(const char* data, size_t length);
+
+  // 格式化为一行文本。
+  void EmitText(const log_internal::RecordHeader& header);
+
+  // 写出格式 ID、时间差和参数字节，调用点在当前文件中首次出现时先写定义。
+  void EmitBinary(const log_internal::RecordHeader& header);
+
+  // 写出调用点定义条目。
+  void EmitDefinition(const LogSite& site, const char* signature);
+
+  // @return 暂存区中可写入 size 字节的位置，空间不足时先写出待写列表
+  char* StagingSpace(size_t size);
+
+  // 把一段完整的日志行加入待写列表，按行数在行边界处切分文件。
+  void AppendChunk(const char* data, size_t length);
+
+  // 把一段数据加入待写列表。
+  void PushPending(const char* data, size_t length);
+
+  // 用 writev 写出待写列表，处理部分写。
+  void WritePending();
+
+  // 日期变化时切换到新一天的文件。
+  void RotateByDay(const struct tm& now);
+
+  // 打开第 part 个切分文件，0 为当天的第一个文件。二进制格式下文件以
+  // .tlog 结尾并以文件头开始，之后的调用点需要重新定义。
+  // @return 打开失败时返回 false 并继续使用原文件
+  bool OpenLogFile(const struct tm& day, long long part);
+
+  // 用当前线程的 TimestampCache 格式化时间戳和级别前缀。
+  // @param buf 至少 kPrefixSize 字节
+  // @param time 日志的时间
+  // @return 写入的字节数
+  static int FormatPrefix(char* buf, LogLevel level,
+                          const struct timespec& time);
+
+  // @return 当前线程缓存的 second 对应的本地时间
+  static const struct tm& LocalTime(time_t second);
 
-  // 获取日志级别的字符串表示。
-  const char* GetLevelString(LogLevel level) const;
 
  private:
+  // 运行时级别门限，LogLevel::kOff 表示关闭
+  static inline std::atomic<int> level_{static_cast<int>(LogLevel::kOff)};
+
   std::filesystem::path dir_name_;     // 目录路径
   std::filesystem::path log_name_;     // 日志文件名
-  int split_lines_;                     // 每个日志文件的最大行数
-  int log_buf_size_;                    // 日志缓冲区大小
-  long long count_;                     // 当前行数
-  int today_;                           // 用于日志切分的当前日期
-  std::unique_ptr<std::FILE, decltype(&std::fclose)> fp_{nullptr, &std::fclose};
-  std::unique_ptr<char[]> buf_;
-  std::unique_ptr<BlockQueue<std::string>> log_queue_;
+  int split_lines_;                     // 每个日志文件的最大行数（条数）
+  int log_buf_size_;                    // 单条日志的最大长度
+  long long count_;                     // 当天已写入的行数
+  struct tm today_;                     // 用于日志切分的当前日期
+  int fd_;                              // 当前日志文件
   bool is_async_;                       // 异步模式标志
-  std::mutex mutex_;
-  int close_log_;                       // 日志禁用标志
-  std::unique_ptr<std::thread> async_thread_;
+  bool binary_;                         // 二进制格式标志
+  std::mutex mutex_;                    // 串行化文件写入与切分
+
+  // 已登记的线程缓冲区
+  ThreadBufferRegistry buffers_;
+
+  // 后台写线程
+  ThreadBufferWriter writer_;
+
+  // 批量写入状态，由 mutex_ 保护
+  std::vector<struct iovec> pending_;
+  std::unique_ptr<char[]> staging_;       // 待写出数据的暂存区
+  size_t staging_size_{0};
+  size_t staging_used_{0};
+  std::unique_ptr<char[]> immediate_;     // 调用线程直接写入时的记录
+
+  // 二进制格式状态，由 mutex_ 保护
+  uint32_t site_count_{0};                // 已分配的格式 ID 数
+  uint64_t file_generation_{0};           // 每打开一个文件加一
+  int64_t last_time_{0};                  // 上一条日志的时间（纳秒）
 };
 
-}  // namespace tinywebserver
+template <typename... Args>
+void Logger::Log(LogSite& site, Args... args) {
+  static_assert((log_internal::kDeferrable<Args> && ...),
+                "log arguments must be arithmetic, pointers or "
+                "std::string_view");
+  size_t size = sizeof(log_internal::RecordHeader) +
+                (size_t{0} + ... + log_internal::EncodedSize(args));
+  if (size > max_record_size()) {
+    // 参数过长：在调用线程上格式化并截断，作为一个字符串参数记录
+    std::vector<char> text(max_message_size());
+    int n = log_internal::Format(text.data(), text.size(), site.format,
+                                 args...);
+    size_t length =
+        n < 0 ? 0 : std::min(static_cast<size_t>(n), text.size() - 1);
+    Log(TruncatedSite(site.level), std::string_view(text.data(), length));
+    return;
+  }
 
-// 便捷的日志记录宏
-#define LOG_DEBUG(format, ...)                                           \
-  do {                                                                   \
-    auto* logger = tinywebserver::Logger::GetInstance();                \
-    if (!logger->IsLogClosed()) {                                       \
-      logger->WriteLog(tinywebserver::LogLevel::kDebug, format,        \
-                       ##__VA_ARGS__);                                   \
-      logger->Flush();                                                   \
-    }                                                                    \
-  } while (0)
+  const log_internal::ArgsInfo* info = &log_internal::kArgsInfo<Args...>;
+  ThreadBuffer* buffer = is_async_ ? buffers_.Local<Logger>() : nullptr;
+  if (buffer != nullptr) {
+    char* out = BeginRecord(buffer, &site, info, size);
+    if (out != nullptr) {
+      ((out = log_internal::Encode(out, args)), ...);
+      CommitRecord(buffer);
+    }
+    return;
+  }
 
-#define LOG_INFO(format, ...)                                            \
-  do {                                                                   \
-    auto* logger = tinywebserver::Logger::GetInstance();                \
-    if (!logger->IsLogClosed()) {                                       \
-      logger->WriteLog(tinywebserver::LogLevel::kInfo, format,         \
-                       ##__VA_ARGS__);                                   \
-      logger->Flush();                                                   \
-    }                                                                    \
-  } while (0)
+  // 同步模式或线程已退出：在调用线程上编码并直接写入
+  std::lock_guard<std::mutex> lock(mutex_);
+  [[maybe_unused]] char* out = BeginImmediate(&site, info, size);
+  ((out = log_internal::Encode(out, args)), ...);
+  EndImmediate();
+}
 
-#define LOG_WARN(format, ...)                                            \
-  do {                                                                   \
-    auto* logger = tinywebserver::Logger::GetInstance();                \
-    if (!logger->IsLogClosed()) {                                       \
-      logger->WriteLog(tinywebserver::LogLevel::kWarn, format,         \
-                       ##__VA_ARGS__);                                   \
-      logger->Flush();                                                   \
-    }                                                                    \
-  } while (0)
+}  // namespace tinywebserver
 
-#define LOG_ERROR(format, ...)                                           \
+// 日志记录宏：编译期门限以下的级别不生成代码，运行时门限只读取一次原子变量。
+// 每个调用点有一个常量初始化的静态 LogSite，二进制格式以它分配格式 ID。
+#define TINYWEBSERVER_LOG(level, format, ...)                            \
   do {                                                                   \
-    auto* logger = tinywebserver::Logger::GetInstance();                \
-    if (!logger->IsLogClosed()) {                                       \
-      logger->WriteLog(tinywebserver::LogLevel::kError, format,        \
-                       ##__VA_ARGS__);                                   \
-      logger->Flush();                                                   \
+    if constexpr (tinywebserver::kLogLevelCompiled<level>) {            \
+      if (tinywebserver::Logger::ShouldLog(level)) {                    \
+        static tinywebserver::LogSite tinywebserver_log_site{            \
+            level, format, __FILE__, __LINE__, 0, 0};                    \
+        tinywebserver::Logger::GetInstance()->Log(tinywebserver_log_site, \
+                                                  ##__VA_ARGS__);        \
+      }                                                                  \
     }                                                                    \
   } while (0)
 
+#define LOG_DEBUG(format, ...) \
+  TINYWEBSERVER_LOG(tinywebserver::LogLevel::kDebug, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) \
+  TINYWEBSERVER_LOG(tinywebserver::LogLevel::kInfo, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) \
+  TINYWEBSERVER_LOG(tinywebserver::LogLevel::kWarn, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) \
+  TINYWEBSERVER_LOG(tinywebserver::LogLevel::kError, format, ##__VA_ARGS__)
+
 #endif  // TINYWEBSERVER_LOG_LOG_H_
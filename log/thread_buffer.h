@@ -0,0 +1,322 @@
+// Copyright 2025 TinyWebServer
+// 每个线程一对轮换使用的追加缓冲区及收集它们的写线程，由日志和访问日志共用
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_LOG_THREAD_BUFFER_H_
+#define TINYWEBSERVER_LOG_THREAD_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tinywebserver {
+
+// 一个线程的追加缓冲区：两块轮换使用，内容是连续的变长记录。
+// 生产者只追加到 active 一块，写满后把它标记为 sealed 交给写线程并切换到
+// 另一块；写线程按顺序收集两块中已提交的数据，写入文件后清空 sealed 的一块
+// 并取消标记，生产者才能再次使用它。
+struct ThreadBuffer {
+  struct Half {
+    std::unique_ptr<char[]> data;
+    std::atomic<size_t> size{0};      // 已提交的字节数
+    std::atomic<bool> sealed{false};  // 已写满，等待写线程写出
+    size_t drained{0};                // 写线程已收集的字节数
+  };
+
+  explicit ThreadBuffer(size_t half_size) : capacity(half_size) {
+    // 不清零，页面在首次写入时才分配
+    halves[0].data.reset(new char[half_size]);
+    halves[1].data.reset(new char[half_size]);
+  }
+
+  // 在当前块中预留一条记录的空间，写满时切换到另一块。
+  // @param max_len 一条记录的最大字节数
+  // @param wake 切换了块或丢弃了记录时调用，用于唤醒写线程
+  // @return 写入位置，后台块还没写完时返回 nullptr 并计入 dropped
+  template <typename Wake>
+  char* Reserve(size_t max_len, Wake&& wake) {
+    Half* half = &halves[active];
+    // 只有本线程修改未 sealed 的一块的 size
+    size_t used = half->size.load(std::memory_order_relaxed);
+    if (capacity - used >= max_len) {
+      return half->data.get() + used;
+    }
+    Half* other = &halves[active ^ 1];
+    if (other->sealed.load(std::memory_order_acquire)) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      wake();
+      return nullptr;
+    }
+    half->sealed.store(true, std::memory_order_release);
+    active ^= 1;
+    wake();
+    return other->data.get();
+  }
+
+  // @return 当前块中 Reserve 返回的位置
+  char* Tail() {
+    Half& half = halves[active];
+    return half.data.get() + half.size.load(std::memory_order_relaxed);
+  }
+
+  // 提交 Reserve 之后写入的 length 字节，写线程此后可见。
+  void Commit(size_t length) {
+    Half& half = halves[active];
+    half.size.store(half.size.load(std::memory_order_relaxed) + length,
+                    std::memory_order_release);
+  }
+
+  // 收集已提交的数据（仅写线程调用）：先收集上次停下的一块，它已写满则
+  // 接着收集另一块，同一线程的记录按写入顺序交给 emit(data, length)。
+  template <typename Emit>
+  void Drain(Emit&& emit) {
+    for (int i = 0; i < 2; ++i) {
+      Half& half = halves[draining];
+      bool sealed = half.sealed.load(std::memory_order_acquire);
+      size_t size = half.size.load(std::memory_order_acquire);
+      if (size > half.drained) {
+        emit(half.data.get() + half.drained, size - half.drained);
+        half.drained = size;
+      }
+      if (!sealed) {
+        break;
+      }
+      release_mask |= 1 << draining;
+      draining ^= 1;
+    }
+  }
+
+  // 收集到的数据写出后，把写满的块交还给生产者（仅写线程调用）。
+  void Release() {
+    for (int i = 0; i < 2; ++i) {
+      if (release_mask & (1 << i)) {
+        Half& half = halves[i];
+        half.drained = 0;
+        half.size.store(0, std::memory_order_relaxed);
+        half.sealed.store(false, std::memory_order_release);
+      }
+    }
+    release_mask = 0;
+  }
+
+  Half halves[2];
+  const size_t capacity;
+  int active{0};                      // 生产者正在追加的一块
+  std::atomic<uint64_t> dropped{0};   // 两块都满时丢弃的记录数
+  std::atomic<bool> retired{false};   // 所属线程已退出
+
+  // 以下字段只由写线程访问
+  int draining{0};                    // 下一块要收集的缓冲区
+  int release_mask{0};                // 本轮写出后需要清空的块
+  bool reclaim{false};                // 本轮收集完后可以释放
+};
+
+// 一个写线程收集的所有线程缓冲区。
+class ThreadBufferRegistry {
+ public:
+  // 设置之后新建的每块缓冲区的大小
+  void set_buffer_size(size_t size) { buffer_size_ = size; }
+
+  // 获取当前线程的缓冲区，首次调用时创建并登记。
+  // 线程退出时把缓冲区标记为 retired，由写线程收集完剩余记录后释放；
+  // 之后同一线程（例如静态对象析构时）再调用返回 nullptr。
+  // 线程局部变量按 Owner 区分，每个 Owner 类型只能有一个登记表。
+  // @return 当前线程的缓冲区；线程已退出时返回 nullptr
+  template <typename Owner>
+  ThreadBuffer* Local() {
+    thread_local ThreadBuffer* current = nullptr;
+    thread_local bool exited = false;
+    struct Handle {
+      std::shared_ptr<ThreadBuffer> buffer;
+      ~Handle() {
+        if (buffer) {
+          buffer->retired.store(true, std::memory_order_release);
+        }
+        current = nullptr;
+        exited = true;
+      }
+    };
+    if (current != nullptr) {
+      return current;
+    }
+    if (exited) {
+      return nullptr;
+    }
+    thread_local Handle handle;
+    handle.buffer = std::make_shared<ThreadBuffer>(buffer_size_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffers_.push_back(handle.buffer);
+    }
+    current = handle.buffer.get();
+    return current;
+  }
+
+  // 复制已登记的缓冲区列表，写线程在锁外逐个收集。
+  void Snapshot(std::vector<std::shared_ptr<ThreadBuffer>>* list) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    list->assign(buffers_.begin(), buffers_.end());
+  }
+
+  // 移除标记了 reclaim 的缓冲区。
+  void Reclaim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                  [](const auto& buffer) {
+                                    return buffer->reclaim;
+                                  }),
+                   buffers_.end());
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  size_t buffer_size_{0};
+};
+
+// 收集一个登记表中所有线程缓冲区的后台写线程。
+// 有缓冲区写满、有调用者等待 Flush 或每隔 interval_ms 时收集一轮：
+// 各线程已提交的数据按线程内的写入顺序交给 emit，全部收集完后调用 write
+// 写出，之后才把写满的块交还给生产者，并释放所属线程已退出的缓冲区。
+class ThreadBufferWriter {
+ public:
+  // 一段已提交的数据，可能包含多条完整的记录
+  using Emit = std::function<void(const char* data, size_t length)>;
+  // 一轮收集结束，dropped 为本轮统计到的丢弃记录数
+  using Write = std::function<void(uint64_t dropped)>;
+
+  ThreadBufferWriter() = default;
+  ~ThreadBufferWriter() { Stop(); }
+
+  ThreadBufferWriter(const ThreadBufferWriter&) = delete;
+  ThreadBufferWriter& operator=(const ThreadBufferWriter&) = delete;
+
+  // 启动写线程。回调只在写线程上调用。
+  // @param registry 要收集的登记表，生存期长于写线程
+  // @param interval_ms 定期收集未写满的缓冲区的间隔
+  void Start(ThreadBufferRegistry* registry, int interval_ms, Emit emit,
+             Write write) {
+    registry_ = registry;
+    interval_ = std::chrono::milliseconds(interval_ms);
+    emit_ = std::move(emit);
+    write_ = std::move(write);
+    thread_ = std::make_unique<std::thread>([this]() { Run(); });
+  }
+
+  // 写线程是否已启动
+  bool running() const { return thread_ != nullptr; }
+
+  // 唤醒写线程，作为 ThreadBuffer::Reserve 的 wake 参数。
+  // 只有第一个写满缓冲区的线程通知写线程；通知可能落在写线程检查条件与
+  // 进入等待之间，此时写线程最多延迟 interval_ms 后被定时唤醒
+  void Wake() {
+    if (!wake_.exchange(true, std::memory_order_acq_rel)) {
+      cond_.notify_one();
+    }
+  }
+
+  // 等待此前提交的数据全部写出。写线程未启动时直接返回。
+  void Flush() {
+    if (!thread_) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = ++flush_requested_;
+    cond_.notify_one();
+    flushed_cond_.wait(lock, [this, target] {
+      return flush_done_ >= target || stop_;
+    });
+  }
+
+  // 停止写线程。写线程退出前会再收集一轮，剩余的数据全部写出。
+  void Stop() {
+    if (!thread_) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_one();
+    thread_->join();
+    thread_.reset();
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cond_.wait_for(lock, interval_, [this] {
+        return stop_ || wake_.load(std::memory_order_relaxed) ||
+               flush_requested_ != flush_done_;
+      });
+      bool stop = stop_;
+      uint64_t flush = flush_requested_;
+      wake_.store(false, std::memory_order_relaxed);
+      lock.unlock();
+
+      DrainAll();
+
+      lock.lock();
+      flush_done_ = flush;
+      flushed_cond_.notify_all();
+      if (stop) {
+        break;
+      }
+    }
+  }
+
+  // 收集一轮并写出
+  void DrainAll() {
+    registry_->Snapshot(&drain_list_);
+    uint64_t dropped = 0;
+    bool reclaim = false;
+    for (const auto& buffer : drain_list_) {
+      // 先读 retired：线程退出后不再追加，本轮收集完即可释放
+      buffer->reclaim = buffer->retired.load(std::memory_order_acquire);
+      reclaim |= buffer->reclaim;
+      dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+      buffer->Drain(emit_);
+    }
+    write_(dropped);
+
+    // 写出后才把写满的块交还给生产者
+    for (const auto& buffer : drain_list_) {
+      buffer->Release();
+    }
+    drain_list_.clear();
+    if (reclaim) {
+      registry_->Reclaim();
+    }
+  }
+
+  ThreadBufferRegistry* registry_{nullptr};
+  std::chrono::milliseconds interval_{0};
+  Emit emit_;
+  Write write_;
+  std::unique_ptr<std::thread> thread_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;          // 唤醒写线程
+  std::condition_variable flushed_cond_;  // 通知 Flush 的调用者
+  std::atomic<bool> wake_{false};         // 有缓冲区写满，避免重复通知
+  bool stop_{false};
+  uint64_t flush_requested_{0};
+  uint64_t flush_done_{0};
+
+  // 只由写线程访问
+  std::vector<std::shared_ptr<ThreadBuffer>> drain_list_;
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_LOG_THREAD_BUFFER_H_
@@ -0,0 +1,469 @@
+// Copyright 2025 TinyWebServer
+// tinylog-decode：把二进制格式的日志文件 (.tlog) 还原为文本日志
+// 遵循 Google C++ 编码规范
+//
+// 用法：tinylog-decode <文件>...
+// 按顺序解码每个文件并写到标准输出，每行的格式与文本格式的日志文件相同。
+// 格式串中的转换说明逐个交给 vsnprintf，参数类型来自文件中的类型签名。
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "log/binary_log.h"
+#include "log/log.h"
+
+namespace tinywebserver {
+namespace {
+
+// 文件中定义的一个调用点
+struct Site {
+  LogLevel level;
+  std::string signature;
+  std::string format;
+};
+
+// 展开后的一个 printf 参数，string_view 对应长度和字符串两个参数
+struct PrintfArg {
+  enum class Kind { kInt, kDouble, kLongDouble, kPointer, kString };
+  Kind kind;
+  long long int_value;
+  double double_value;
+  long double long_double_value;
+  const void* pointer;
+};
+
+PrintfArg IntArg(long long value) {
+  return {PrintfArg::Kind::kInt, value, 0.0, 0.0L, nullptr};
+}
+
+PrintfArg PointerArg(PrintfArg::Kind kind, const void* pointer) {
+  return {kind, 0, 0.0, 0.0L, pointer};
+}
+
+template <typename T>
+bool ReadValue(const char** in, const char* end, T* value) {
+  if (static_cast<size_t>(end - *in) < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(value, *in, sizeof(T));
+  *in += sizeof(T);
+  return true;
+}
+
+template <typename T>
+bool ReadInt(const char** in, const char* end, std::vector<PrintfArg>* args) {
+  T value;
+  if (!ReadValue(in, end, &value)) {
+    return false;
+  }
+  args->push_back(IntArg(static_cast<long long>(value)));
+  return true;
+}
+
+// 读取 varint 长度加内容的字符串
+bool ReadString(const char** in, const char* end, std::string* str) {
+  uint64_t length;
+  if (!binary_log::GetVarint(in, end, &length) ||
+      length > static_cast<uint64_t>(end - *in)) {
+    return false;
+  }
+  str->assign(*in, length);
+  *in += length;
+  return true;
+}
+
+// 按类型签名解码一条日志的参数，字符串指向文件映射中的副本
+// @return 数据不完整或签名无法识别时返回 false
+bool DecodeArgs(const std::string& signature, const char** in,
+                const char* end, std::vector<PrintfArg>* args) {
+  args->clear();
+  for (char code : signature) {
+    bool ok = true;
+    switch (code) {
+      case 'b':
+        ok = ReadInt<bool>(in, end, args);
+        break;
+      case 'c':
+        ok = ReadInt<signed char>(in, end, args);
+        break;
+      case 'C':
+        ok = ReadInt<unsigned char>(in, end, args);
+        break;
+      case 'h':
+        ok = ReadInt<int16_t>(in, end, args);
+        break;
+      case 'H':
+        ok = ReadInt<uint16_t>(in, end, args);
+        break;
+      case 'i':
+        ok = ReadInt<int32_t>(in, end, args);
+        break;
+      case 'u':
+        ok = ReadInt<uint32_t>(in, end, args);
+        break;
+      case 'l':
+        ok = ReadInt<int64_t>(in, end, args);
+        break;
+      case 'U':
+        ok = ReadInt<uint64_t>(in, end, args);
+        break;
+      case 'f': {
+        float value;
+        ok = ReadValue(in, end, &value);
+        if (ok) {
+          args->push_back({PrintfArg::Kind::kDouble, 0,
+                           static_cast<double>(value), 0.0L, nullptr});
+        }
+        break;
+      }
+      case 'd': {
+        double value;
+        ok = ReadValue(in, end, &value);
+        if (ok) {
+          args->push_back({PrintfArg::Kind::kDouble, 0, value, 0.0L, nullptr});
+        }
+        break;
+      }
+      case 'D': {
+        long double value;
+        ok = ReadValue(in, end, &value);
+        if (ok) {
+          args->push_back(
+              {PrintfArg::Kind::kLongDouble, 0, 0.0, value, nullptr});
+        }
+        break;
+      }
+      case 'p':
+      case 'n': {
+        const void* value;
+        ok = ReadValue(in, end, &value);
+        if (ok) {
+          args->push_back(PointerArg(PrintfArg::Kind::kPointer, value));
+        }
+        break;
+      }
+      case 's':
+      case 'v': {
+        uint32_t length;
+        ok = ReadValue(in, end, &length) &&
+             static_cast<size_t>(end - *in) > length;
+        if (ok) {
+          if (code == 'v') {
+            args->push_back(IntArg(length));
+          }
+          args->push_back(PointerArg(PrintfArg::Kind::kString, *in));
+          *in += length + 1;
+        }
+        break;
+      }
+      default:
+        ok = false;
+        break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 用一个转换说明格式化并追加到 out
+template <typename... Values>
+void AppendFormatted(std::string* out, const std::string& spec,
+                     Values... values) {
+  char buf[256];
+  int n = log_internal::FormatV(buf, sizeof(buf), spec.c_str(), values...);
+  if (n < 0) {
+    return;
+  }
+  auto length = static_cast<size_t>(n);
+  if (length < sizeof(buf)) {
+    out->append(buf, length);
+    return;
+  }
+  size_t old_size = out->size();
+  out->resize(old_size + length + 1);
+  log_internal::FormatV(&(*out)[old_size], length + 1, spec.c_str(),
+                        values...);
+  out->resize(old_size + length);
+}
+
+// 带 0 到 2 个 '*' 宽度/精度参数格式化
+template <typename T>
+void AppendSpec(std::string* out, const std::string& spec, const int* stars,
+                int star_count, T value) {
+  if (star_count == 0) {
+    AppendFormatted(out, spec, value);
+  } else if (star_count == 1) {
+    AppendFormatted(out, spec, stars[0], value);
+  } else {
+    AppendFormatted(out, spec, stars[0], stars[1], value);
+  }
+}
+
+// 按格式串逐个处理转换说明，长度修饰符按解码出的实际类型重写
+void FormatMessage(const std::string& format,
+                   const std::vector<PrintfArg>& args, std::string* out) {
+  using Kind = PrintfArg::Kind;
+  size_t next = 0;
+  auto take = [&]() -> const PrintfArg* {
+    return next < args.size() ? &args[next++] : nullptr;
+  };
+
+  size_t i = 0;
+  while (i < format.size()) {
+    if (format[i] != '%') {
+      size_t percent = format.find('%', i);
+      if (percent == std::string::npos) {
+        percent = format.size();
+      }
+      out->append(format, i, percent - i);
+      i = percent;
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '%') {
+      out->push_back('%');
+      i += 2;
+      continue;
+    }
+
+    // %[标志][宽度][.精度][长度修饰符]转换符
+    std::string spec = "%";
+    int stars[2] = {0, 0};
+    int star_count = 0;
+    size_t j = i + 1;
+    auto parse_number = [&] {
+      if (j < format.size() && format[j] == '*') {
+        const PrintfArg* arg = take();
+        stars[star_count++] =
+            arg != nullptr && arg->kind == Kind::kInt
+                ? static_cast<int>(arg->int_value)
+                : 0;
+        spec.push_back('*');
+        ++j;
+        return;
+      }
+      while (j < format.size() && format[j] >= '0' && format[j] <= '9') {
+        spec.push_back(format[j++]);
+      }
+    };
+    while (j < format.size() && std::strchr("-+ #0'", format[j]) != nullptr) {
+      spec.push_back(format[j++]);
+    }
+    parse_number();
+    if (j < format.size() && format[j] == '.') {
+      spec.push_back('.');
+      ++j;
+      parse_number();
+    }
+    while (j < format.size() && std::strchr("hlLqjzt", format[j]) != nullptr) {
+      ++j;
+    }
+    if (j >= format.size()) {
+      out->append(format, i, std::string::npos);
+      break;
+    }
+    char conversion = format[j];
+    i = j + 1;
+
+    const PrintfArg* arg = take();
+    bool ok = arg != nullptr;
+    if (ok) {
+      switch (conversion) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+          ok = arg->kind == Kind::kInt;
+          if (ok) {
+            AppendSpec(out, spec + "ll" + conversion, stars, star_count,
+                       arg->int_value);
+          }
+          break;
+        case 'c':
+          ok = arg->kind == Kind::kInt;
+          if (ok) {
+            AppendSpec(out, spec + 'c', stars, star_count,
+                       static_cast<int>(arg->int_value));
+          }
+          break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+          if (arg->kind == Kind::kLongDouble) {
+            AppendSpec(out, spec + 'L' + conversion, stars, star_count,
+                       arg->long_double_value);
+          } else if (arg->kind == Kind::kDouble) {
+            AppendSpec(out, spec + conversion, stars, star_count,
+                       arg->double_value);
+          } else {
+            ok = false;
+          }
+          break;
+        case 's':
+          ok = arg->kind == Kind::kString;
+          if (ok) {
+            AppendSpec(out, spec + 's', stars, star_count,
+                       static_cast<const char*>(arg->pointer));
+          }
+          break;
+        case 'p':
+          ok = arg->kind == Kind::kPointer || arg->kind == Kind::kString;
+          if (ok) {
+            AppendSpec(out, spec + 'p', stars, star_count, arg->pointer);
+          }
+          break;
+        case 'n':
+          // 不写回，只消耗参数
+          break;
+        default:
+          ok = false;
+          break;
+      }
+    }
+    if (!ok) {
+      out->append("<?>");
+    }
+  }
+}
+
+// 解码一个文件并写到 output
+// @return 文件完整且格式正确时返回 true
+bool DecodeFile(const char* path, FILE* output) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    std::fprintf(stderr, "tinylog-decode: cannot open %s: %s\n", path,
+                 std::strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return st.st_size == 0;
+  }
+  auto size = static_cast<size_t>(st.st_size);
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    std::fprintf(stderr, "tinylog-decode: cannot map %s: %s\n", path,
+                 std::strerror(errno));
+    return false;
+  }
+
+  const char* begin = static_cast<const char*>(mapped);
+  const char* end = begin + size;
+  const char* in = begin;
+  std::unordered_map<uint64_t, Site> sites;
+  int64_t time = 0;
+  TimestampCache timestamps;
+  std::vector<PrintfArg> args;
+  std::string line;
+  const char* entry = in;
+  const char* error = nullptr;
+
+  while (in < end) {
+    entry = in;
+    char tag = *in++;
+    if (tag == binary_log::kTagMagic) {
+      constexpr size_t kRest = sizeof(binary_log::kMagic) - 1;
+      if (static_cast<size_t>(end - in) < kRest ||
+          std::memcmp(in, binary_log::kMagic + 1, kRest) != 0) {
+        error = "bad file header";
+        break;
+      }
+      in += kRest;
+      sites.clear();
+      time = 0;
+    } else if (tag == binary_log::kTagDefine) {
+      uint64_t id;
+      uint64_t source_line;
+      std::string file;
+      Site site;
+      if (!binary_log::GetVarint(&in, end, &id) || in >= end) {
+        error = "truncated definition";
+        break;
+      }
+      site.level = static_cast<LogLevel>(*in++);
+      if (!binary_log::GetVarint(&in, end, &source_line) ||
+          !ReadString(&in, end, &file) ||
+          !ReadString(&in, end, &site.signature) ||
+          !ReadString(&in, end, &site.format)) {
+        error = "truncated definition";
+        break;
+      }
+      sites[id] = std::move(site);
+    } else if (tag == binary_log::kTagLog) {
+      uint64_t id;
+      uint64_t delta;
+      if (!binary_log::GetVarint(&in, end, &id) ||
+          !binary_log::GetVarint(&in, end, &delta)) {
+        error = "truncated record";
+        break;
+      }
+      auto it = sites.find(id);
+      if (it == sites.end()) {
+        error = "record refers to an undefined format id";
+        break;
+      }
+      if (!DecodeArgs(it->second.signature, &in, end, &args)) {
+        error = "truncated record arguments";
+        break;
+      }
+      time += binary_log::UnZigZag(delta);
+      struct timespec ts;
+      ts.tv_sec = time / 1000000000;
+      ts.tv_nsec = time % 1000000000;
+
+      char prefix[TimestampCache::kMaxLength];
+      line.assign(prefix, timestamps.Format(ts, prefix));
+      line.push_back(' ');
+      line.append(Logger::GetLevelString(it->second.level));
+      line.push_back(' ');
+      FormatMessage(it->second.format, args, &line);
+      line.push_back('\n');
+      std::fwrite(line.data(), 1, line.size(), output);
+    } else {
+      error = "unknown entry tag";
+      break;
+    }
+  }
+
+  if (error != nullptr) {
+    // 写线程可能在写出一批数据的中途被终止，文件尾部的残缺条目只报告不解码
+    std::fprintf(stderr, "tinylog-decode: %s: %s at offset %zu\n", path, error,
+                 static_cast<size_t>(entry - begin));
+  }
+  munmap(mapped, size);
+  return error == nullptr;
+}
+
+}  // namespace
+}  // namespace tinywebserver
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s <file.tlog>...\n", argv[0]);
+    return 2;
+  }
+  bool ok = true;
+  for (int i = 1; i < argc; ++i) {
+    ok = tinywebserver::DecodeFile(argv[i], stdout) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -35,17 +35,29 @@ int main(int argc, char* argv[]) {
         config.log_write_mode(), config.opt_linger(), 
         config.trigger_mode(), config.sql_connection_num(),
         config.thread_num(), config.close_log(), 
-        config.actor_model());
+        config.actor_model(), config.reactor_num(),
+        config.work_stealing());
 
     // Initialize subsystems
     std::cout << "[DEBUG] Initializing log system..." << std::endl;
-    server.InitLog();
+    server.InitLog(config.log_level(), config.log_binary());
+    server.InitAccessLog(config.access_log(), config.access_log_sample());
     std::cout << "[DEBUG] Log system initialized" << std::endl;
     
     std::cout << "[DEBUG] Initializing SQL pool..." << std::endl;
     server.InitSqlPool();
+    server.InitUserStore(config.user_refresh_s());
     std::cout << "[DEBUG] SQL pool initialized" << std::endl;
     
+    std::cout << "[DEBUG] Initializing file cache..." << std::endl;
+    server.InitFileCache(config.file_cache_mb(), config.file_cache_max_kb(),
+                         config.file_cache_revalidate_ms(),
+                         config.sendfile_threshold_kb());
+    server.InitCacheControl(config.cache_control_rules());
+    server.InitCompression(config.compression());
+    server.InitMimeTypes(config.mime_types_file());
+    std::cout << "[DEBUG] File cache initialized" << std::endl;
+    
     std::cout << "[DEBUG] Initializing thread pool..." << std::endl;
     server.InitThreadPool();
     std::cout << "[DEBUG] Thread pool initialized" << std::endl;
@@ -0,0 +1,179 @@
+// Copyright 2025 TinyWebServer
+// 任务派发路径的堆分配与吞吐量基准测试
+// 遵循 Google C++ 编码规范
+//
+// 对比旧的 shared_ptr + std::queue 派发方式与 ThreadPool 的两种调度器，
+// 统计每次派发触发的 operator new 次数。
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "threadpool/threadpool.h"
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace tinywebserver {
+namespace {
+
+constexpr int kConnections = 1024;
+constexpr int kEventsPerRun = 1000000;
+constexpr int kThreads = 4;
+constexpr int kMaxRequests = 10000;
+
+std::atomic<int> g_completed{0};
+
+// 模拟 HttpConnection 的最小接口；基准只派发写事件。
+// TaskHandle 把事件类型存在指针低位，因此按指针对齐
+struct alignas(alignof(void*)) FakeConnection {
+  bool read_once() { return true; }
+  bool process() { return true; }
+  bool write() { return true; }
+  bool HasBufferedRequest() const { return false; }
+  void PostCompletion(CompletionType) {
+    g_completed.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+// 旧实现：每次派发构造一个空删除器的 shared_ptr 并放入 std::queue
+class LegacyPool {
+ public:
+  LegacyPool() {
+    for (int i = 0; i < kThreads; ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~LegacyPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  bool Append(std::shared_ptr<FakeConnection> request) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (queue_.size() >= static_cast<size_t>(kMaxRequests)) {
+        return false;
+      }
+      queue_.push(std::move(request));
+    }
+    cond_.notify_one();
+    return true;
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::shared_ptr<FakeConnection> request;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        request = std::move(queue_.front());
+        queue_.pop();
+      }
+      request->PostCompletion(request->write() ? CompletionType::kAdjustTimer
+                                               : CompletionType::kClose);
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::queue<std::shared_ptr<FakeConnection>> queue_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_{false};
+};
+
+template <typename Submit>
+void RunCase(const char* name, Submit&& submit) {
+  g_completed.store(0);
+  size_t allocations_before = g_allocations.load();
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < static_cast<size_t>(kEventsPerRun); ++i) {
+    while (!submit(i % static_cast<size_t>(kConnections))) {
+      std::this_thread::yield();
+    }
+  }
+  while (g_completed.load(std::memory_order_relaxed) < kEventsPerRun) {
+    std::this_thread::yield();
+  }
+
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  size_t allocations = g_allocations.load() - allocations_before;
+  std::printf("%-22s %10.0f events/s  %8.3f allocs/event\n", name,
+              kEventsPerRun / elapsed,
+              static_cast<double>(allocations) / kEventsPerRun);
+}
+
+}  // namespace
+}  // namespace tinywebserver
+
+int main() {
+  using tinywebserver::FakeConnection;
+  using tinywebserver::LegacyPool;
+  using tinywebserver::RunCase;
+  using tinywebserver::ThreadPool;
+
+  std::vector<FakeConnection> connections(
+      static_cast<size_t>(tinywebserver::kConnections));
+  {
+    LegacyPool pool;
+    RunCase("shared_ptr + queue", [&](size_t fd) {
+      return pool.Append(std::shared_ptr<FakeConnection>(
+          &connections[fd], [](FakeConnection*) {}));
+    });
+  }
+
+  {
+    ThreadPool<FakeConnection> pool(1, tinywebserver::kThreads,
+                                    tinywebserver::kMaxRequests, false);
+    RunCase("TaskHandle + ring", [&](size_t fd) {
+      return pool.Append(&connections[fd], 1);
+    });
+  }
+
+  {
+    ThreadPool<FakeConnection> pool(1, tinywebserver::kThreads,
+                                    tinywebserver::kMaxRequests, true);
+    RunCase("TaskHandle + stealing", [&](size_t fd) {
+      return pool.Append(&connections[fd], 1);
+    });
+  }
+
+  return 0;
+}
@@ -0,0 +1,406 @@
+// Copyright 2025 TinyWebServer
+// 请求解析基准测试：逐字节状态机与 SIMD 零拷贝解析器
+// 遵循 Google C++ 编码规范
+//
+// 语料为抓取的真实请求（curl、浏览器页面导航、带 Cookie 的静态资源、
+// 表单 POST、webbench）。每轮先把请求复制进读缓冲区（对应 recv），再解析
+// 并取出服务端关心的头部，测量：
+//   whole   - 请求一次性到达
+//   64B     - 请求按 64 字节分段到达，每到一段解析一次
+
+#include <strings.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/http_parser.h"
+
+namespace tinywebserver {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kIterations = 200000;
+constexpr size_t kBufferSize = 2048;
+constexpr size_t kChunkSize = 64;
+
+struct Corpus {
+  const char* name;
+  std::string request;
+};
+
+std::vector<Corpus> Corpora() {
+  return {
+      {"curl",
+       "GET /style.css HTTP/1.1\r\n"
+       "Host: 127.0.0.1:9006\r\n"
+       "User-Agent: curl/8.5.0\r\n"
+       "Accept: */*\r\n"
+       "\r\n"},
+      {"browser",
+       "GET /judge.html HTTP/1.1\r\n"
+       "Host: 192.168.1.20:9006\r\n"
+       "Connection: keep-alive\r\n"
+       "Cache-Control: max-age=0\r\n"
+       "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", "
+       "\"Not-A.Brand\";v=\"99\"\r\n"
+       "sec-ch-ua-mobile: ?0\r\n"
+       "sec-ch-ua-platform: \"Linux\"\r\n"
+       "Upgrade-Insecure-Requests: 1\r\n"
+       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+       "(KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+       "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+       "image/avif,image/webp,image/apng,*/*;q=0.8,"
+       "application/signed-exchange;v=b3;q=0.7\r\n"
+       "Sec-Fetch-Site: none\r\n"
+       "Sec-Fetch-Mode: navigate\r\n"
+       "Sec-Fetch-User: ?1\r\n"
+       "Sec-Fetch-Dest: document\r\n"
+       "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+       "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+       "If-None-Match: \"1311768-1676-1760580338000000000\"\r\n"
+       "If-Modified-Since: Thu, 16 Oct 2025 02:05:38 GMT\r\n"
+       "\r\n"},
+      {"asset+cookie",
+       "GET /xxx.jpg HTTP/1.1\r\n"
+       "Host: 192.168.1.20:9006\r\n"
+       "Connection: keep-alive\r\n"
+       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+       "(KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+       "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,"
+       "*/*;q=0.8\r\n"
+       "Referer: http://192.168.1.20:9006/picture.html\r\n"
+       "Accept-Encoding: gzip, deflate, br\r\n"
+       "Accept-Language: zh-CN,zh;q=0.9\r\n"
+       "Cookie: _ga=GA1.1.1234567890.1700000000; "
+       "session=3f6b2c1e9a8d4f7e0b5c6a2d1e8f9a7b3c4d5e6f; "
+       "_ga_ABCDEF=GS1.1.1700000000.3.1.1700000123.0.0.0; "
+       "theme=dark; lang=zh-CN\r\n"
+       "Range: bytes=0-65535\r\n"
+       "If-Range: \"1311770-83048-1760580338000000000\"\r\n"
+       "\r\n"},
+      {"form post",
+       "POST /2CGISQL.cgi HTTP/1.1\r\n"
+       "Host: 192.168.1.20:9006\r\n"
+       "Connection: keep-alive\r\n"
+       "Content-Length: 26\r\n"
+       "Origin: http://192.168.1.20:9006\r\n"
+       "Content-Type: application/x-www-form-urlencoded\r\n"
+       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+       "(KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+       "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+       "*/*;q=0.8\r\n"
+       "Referer: http://192.168.1.20:9006/log.html\r\n"
+       "Accept-Encoding: gzip, deflate\r\n"
+       "\r\n"
+       "user=tinyweb&password=1234"},
+      {"webbench",
+       "GET /judge.html HTTP/1.1\r\n"
+       "User-Agent: WebBench 1.5\r\n"
+       "Host: 127.0.0.1\r\n"
+       "Connection: close\r\n"
+       "\r\n"},
+  };
+}
+
+// 服务端关心的请求字段
+struct RequestFields {
+  std::string_view method;
+  std::string_view url;
+  std::string_view host;
+  std::string_view range;
+  std::string_view if_range;
+  std::string_view if_none_match;
+  std::string_view if_modified_since;
+  std::string_view accept_encoding;
+  size_t content_length = 0;
+  bool linger = false;
+};
+
+// 原 HttpConnection 的解析流程：逐字节找 CRLF 并写入 '\0'，头部依次
+// strncasecmp 匹配。原实现还对每行和每个未知头部调用 LOG_INFO，这里
+// 省略日志，只比较解析本身
+class LegacyParser {
+ public:
+  enum class State { kRequestLine, kHeader, kContent };
+  enum class LineStatus { kOk, kBad, kOpen };
+
+  void Reset() {
+    checked_idx_ = 0;
+    start_line_ = 0;
+    state_ = State::kRequestLine;
+    fields_ = RequestFields{};
+  }
+
+  // @return 1 完成，0 需要更多数据，-1 错误
+  int Parse(char* buf, size_t size) {
+    LineStatus line_status = LineStatus::kOk;
+    while ((state_ == State::kContent && line_status == LineStatus::kOk) ||
+           (line_status = ParseLine(buf, size)) == LineStatus::kOk) {
+      char* text = buf + start_line_;
+      start_line_ = checked_idx_;
+      switch (state_) {
+        case State::kRequestLine:
+          if (!ParseRequestLine(text)) return -1;
+          break;
+        case State::kHeader:
+          if (text[0] == '\0') {
+            if (fields_.content_length == 0) return 1;
+            state_ = State::kContent;
+          } else {
+            ParseHeader(text);
+          }
+          break;
+        case State::kContent:
+          if (size >= fields_.content_length + checked_idx_) return 1;
+          line_status = LineStatus::kOpen;
+          break;
+      }
+    }
+    return line_status == LineStatus::kBad ? -1 : 0;
+  }
+
+  const RequestFields& fields() const { return fields_; }
+
+ private:
+  LineStatus ParseLine(char* buf, size_t size) {
+    for (; checked_idx_ < size; ++checked_idx_) {
+      char temp = buf[checked_idx_];
+      if (temp == '\r') {
+        if (checked_idx_ + 1 == size) return LineStatus::kOpen;
+        if (buf[checked_idx_ + 1] == '\n') {
+          buf[checked_idx_++] = '\0';
+          buf[checked_idx_++] = '\0';
+          return LineStatus::kOk;
+        }
+        return LineStatus::kBad;
+      } else if (temp == '\n') {
+        if (checked_idx_ > 1 && buf[checked_idx_ - 1] == '\r') {
+          buf[checked_idx_ - 1] = '\0';
+          buf[checked_idx_++] = '\0';
+          return LineStatus::kOk;
+        }
+        return LineStatus::kBad;
+      }
+    }
+    return LineStatus::kOpen;
+  }
+
+  bool ParseRequestLine(char* text) {
+    char* url = strpbrk(text, " \t");
+    if (!url) return false;
+    *url++ = '\0';
+    if (strcasecmp(text, "GET") != 0 && strcasecmp(text, "POST") != 0) {
+      return false;
+    }
+    fields_.method = text;
+    url += strspn(url, " \t");
+    char* version = strpbrk(url, " \t");
+    if (!version) return false;
+    *version++ = '\0';
+    version += strspn(version, " \t");
+    if (strcasecmp(version, "HTTP/1.1") != 0) return false;
+    if (url[0] != '/') return false;
+    fields_.url = url;
+    state_ = State::kHeader;
+    return true;
+  }
+
+  void ParseHeader(char* text) {
+    if (strncasecmp(text, "Connection:", 11) == 0) {
+      text += 11;
+      text += strspn(text, " \t");
+      if (strcasecmp(text, "keep-alive") == 0) fields_.linger = true;
+    } else if (strncasecmp(text, "Content-length:", 15) == 0) {
+      text += 15;
+      text += strspn(text, " \t");
+      fields_.content_length = static_cast<size_t>(atol(text));
+    } else if (strncasecmp(text, "Host:", 5) == 0) {
+      fields_.host = Value(text + 5);
+    } else if (strncasecmp(text, "Range:", 6) == 0) {
+      fields_.range = Value(text + 6);
+    } else if (strncasecmp(text, "If-Range:", 9) == 0) {
+      fields_.if_range = Value(text + 9);
+    } else if (strncasecmp(text, "If-None-Match:", 14) == 0) {
+      fields_.if_none_match = Value(text + 14);
+    } else if (strncasecmp(text, "If-Modified-Since:", 18) == 0) {
+      fields_.if_modified_since = Value(text + 18);
+    } else if (strncasecmp(text, "Accept-Encoding:", 16) == 0) {
+      fields_.accept_encoding = Value(text + 16);
+    }
+  }
+
+  static std::string_view Value(const char* text) {
+    return text + strspn(text, " \t");
+  }
+
+  size_t checked_idx_ = 0;
+  size_t start_line_ = 0;
+  State state_ = State::kRequestLine;
+  RequestFields fields_;
+};
+
+bool HeaderIs(std::string_view name, std::string_view expected) {
+  return name.size() == expected.size() &&
+         strncasecmp(name.data(), expected.data(), name.size()) == 0;
+}
+
+// 与 HttpConnection::ParseHeaders 相同：按名称长度分派后再比较
+void ExtractFields(const HttpRequestParser& parser, RequestFields* fields) {
+  fields->method = parser.method();
+  fields->url = parser.target();
+  fields->content_length = parser.content_length();
+  for (int i = 0; i < parser.header_count(); ++i) {
+    HttpRequestParser::Header header = parser.header(i);
+    switch (header.name.size()) {
+      case 4:
+        if (HeaderIs(header.name, "Host")) fields->host = header.value;
+        break;
+      case 5:
+        if (HeaderIs(header.name, "Range")) fields->range = header.value;
+        break;
+      case 8:
+        if (HeaderIs(header.name, "If-Range")) fields->if_range = header.value;
+        break;
+      case 10:
+        if (HeaderIs(header.name, "Connection")) {
+          fields->linger = HeaderIs(header.value, "keep-alive");
+        }
+        break;
+      case 13:
+        if (HeaderIs(header.name, "If-None-Match")) {
+          fields->if_none_match = header.value;
+        }
+        break;
+      case 15:
+        if (HeaderIs(header.name, "Accept-Encoding")) {
+          fields->accept_encoding = header.value;
+        }
+        break;
+      case 17:
+        if (HeaderIs(header.name, "If-Modified-Since")) {
+          fields->if_modified_since = header.value;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// 防止编译器把解析结果当作无用代码删除
+volatile size_t g_sink = 0;
+
+void Consume(const RequestFields& fields) {
+  g_sink = g_sink + fields.url.size() + fields.host.size() +
+           fields.accept_encoding.size() + fields.content_length +
+           (fields.linger ? 1 : 0);
+}
+
+double NsPerRequest(Clock::time_point start) {
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start)
+                .count();
+  return static_cast<double>(ns) / kIterations;
+}
+
+// @param chunk 每次到达的字节数，0 表示整个请求一次到达
+double BenchLegacy(const std::string& request, size_t chunk) {
+  char buf[kBufferSize];
+  LegacyParser parser;
+  auto start = Clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    parser.Reset();
+    size_t step = chunk == 0 ? request.size() : chunk;
+    for (size_t received = 0; received < request.size();) {
+      size_t n = std::min(step, request.size() - received);
+      memcpy(buf + received, request.data() + received, n);
+      received += n;
+      if (parser.Parse(buf, received) != 0) break;
+    }
+    Consume(parser.fields());
+  }
+  return NsPerRequest(start);
+}
+
+double BenchSimd(const std::string& request, size_t chunk) {
+  char buf[kBufferSize];
+  HttpRequestParser parser;
+  auto start = Clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    parser.Reset();
+    size_t step = chunk == 0 ? request.size() : chunk;
+    RequestFields fields;
+    for (size_t received = 0; received < request.size();) {
+      size_t n = std::min(step, request.size() - received);
+      memcpy(buf + received, request.data() + received, n);
+      received += n;
+      HttpRequestParser::Status status = parser.Parse(buf, received);
+      if (status == HttpRequestParser::Status::kComplete) {
+        ExtractFields(parser, &fields);
+        break;
+      }
+      if (status == HttpRequestParser::Status::kError) break;
+    }
+    Consume(fields);
+  }
+  return NsPerRequest(start);
+}
+
+// 两种解析器取出的字段必须一致，否则对比没有意义
+bool SameFields(const std::string& request) {
+  char legacy_buf[kBufferSize];
+  char simd_buf[kBufferSize];
+  memcpy(legacy_buf, request.data(), request.size());
+  memcpy(simd_buf, request.data(), request.size());
+  LegacyParser legacy;
+  legacy.Reset();
+  HttpRequestParser parser;
+  if (legacy.Parse(legacy_buf, request.size()) != 1 ||
+      parser.Parse(simd_buf, request.size()) !=
+          HttpRequestParser::Status::kComplete) {
+    return false;
+  }
+  RequestFields fields;
+  ExtractFields(parser, &fields);
+  const RequestFields& expected = legacy.fields();
+  return fields.url == expected.url && fields.host == expected.host &&
+         fields.range == expected.range &&
+         fields.if_range == expected.if_range &&
+         fields.if_none_match == expected.if_none_match &&
+         fields.if_modified_since == expected.if_modified_since &&
+         fields.accept_encoding == expected.accept_encoding &&
+         fields.content_length == expected.content_length &&
+         fields.linger == expected.linger;
+}
+
+}  // namespace
+}  // namespace tinywebserver
+
+int main() {
+  using tinywebserver::kChunkSize;
+  __builtin_cpu_init();
+  std::printf("scan path: %s\n",
+              __builtin_cpu_supports("avx2") ? "AVX2" : "SSE2/scalar");
+  std::printf("%-14s %6s %14s %14s %14s %14s\n", "corpus", "bytes",
+              "legacy ns", "simd ns", "legacy 64B ns", "simd 64B ns");
+  for (const auto& corpus : tinywebserver::Corpora()) {
+    if (!tinywebserver::SameFields(corpus.request)) {
+      std::fprintf(stderr, "%s: parsers disagree\n", corpus.name);
+      return 1;
+    }
+    std::printf("%-14s %6zu %14.1f %14.1f %14.1f %14.1f\n", corpus.name,
+                corpus.request.size(),
+                tinywebserver::BenchLegacy(corpus.request, 0),
+                tinywebserver::BenchSimd(corpus.request, 0),
+                tinywebserver::BenchLegacy(corpus.request, kChunkSize),
+                tinywebserver::BenchSimd(corpus.request, kChunkSize));
+  }
+  return 0;
+}
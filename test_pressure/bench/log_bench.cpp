@@ -0,0 +1,116 @@
+// Copyright 2025 TinyWebServer
+// 日志时间前缀基准测试：每条日志 localtime_r + snprintf 与按秒缓存
+// 遵循 Google C++ 编码规范
+//
+// 测量格式化一整行日志（时间前缀、级别和内容）的吞吐量，即异步模式下
+// 写线程处理每条记录、同步模式下调用线程写每条日志的格式化开销：
+//   snprintf - 旧实现：每条日志 localtime_r 并用 snprintf 输出完整日期
+//   cached   - 现实现：TimestampCache 每秒重建一次日期，只改写微秒
+// 分别在 1 个和 4 个线程上运行，每个线程使用自己的缓存，
+// 多线程时 localtime_r 内部的 glibc 锁会产生竞争。输出每秒消息数。
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "log/log.h"
+
+namespace tinywebserver {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMessagesPerThread = 2000000;
+constexpr size_t kLineSize = 512;
+
+int FormatMessage(char* buf, size_t size, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = std::vsnprintf(buf, size, format, args);
+  va_end(args);
+  return n;
+}
+
+// 旧实现：每条日志都转换并格式化完整的日期
+size_t LegacyLine(char* buf, const struct timespec& time, int i) {
+  struct tm now;
+  localtime_r(&time.tv_sec, &now);
+  int n = std::snprintf(buf, kLineSize, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s ",
+                        now.tm_year + 1900, now.tm_mon + 1, now.tm_mday,
+                        now.tm_hour, now.tm_min, now.tm_sec,
+                        time.tv_nsec / 1000, "[INFO]:");
+  n += FormatMessage(buf + n, kLineSize - static_cast<size_t>(n),
+                     "GET /index.html?id=%d status %d", i, 200);
+  return static_cast<size_t>(n);
+}
+
+// 现实现：按秒缓存日期部分
+size_t CachedLine(TimestampCache* cache, char* buf,
+                  const struct timespec& time, int i) {
+  size_t n = cache->Format(time, buf);
+  std::memcpy(buf + n, " [INFO]: ", 9);
+  n += 9;
+  n += static_cast<size_t>(FormatMessage(buf + n, kLineSize - n,
+                                         "GET /index.html?id=%d status %d",
+                                         i, 200));
+  return n;
+}
+
+size_t g_sink = 0;
+
+template <bool kCached>
+void Worker(size_t* bytes) {
+  TimestampCache cache;
+  char line[kLineSize];
+  size_t total = 0;
+  for (int i = 0; i < kMessagesPerThread; ++i) {
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    if constexpr (kCached) {
+      total += CachedLine(&cache, line, time, i);
+    } else {
+      total += LegacyLine(line, time, i);
+    }
+  }
+  *bytes = total;
+}
+
+// @return 每秒格式化的消息数
+template <bool kCached>
+double Bench(int threads) {
+  std::vector<std::thread> workers;
+  std::vector<size_t> bytes(static_cast<size_t>(threads));
+  auto start = Clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back(Worker<kCached>, &bytes[static_cast<size_t>(t)]);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  for (size_t n : bytes) {
+    g_sink += n;
+  }
+  return static_cast<double>(kMessagesPerThread) * threads / seconds;
+}
+
+}  // namespace
+}  // namespace tinywebserver
+
+int main() {
+  using tinywebserver::Bench;
+  std::printf("%-10s %8s %16s\n", "impl", "threads", "messages/s");
+  for (int threads : {1, 4}) {
+    std::printf("%-10s %8d %16.0f\n", "snprintf", threads,
+                Bench<false>(threads));
+    std::printf("%-10s %8d %16.0f\n", "cached", threads,
+                Bench<true>(threads));
+  }
+  std::printf("(sink %zu)\n", tinywebserver::g_sink);
+  return 0;
+}
@@ -0,0 +1,254 @@
+// Copyright 2025 TinyWebServer
+// 保活请求的状态重置基准测试：逐请求清零缓冲区与 O(1) 重置
+// 遵循 Google C++ 编码规范
+//
+// 模拟保活连接上的请求周期：重置连接状态，把请求复制进读缓冲区（对应
+// recv），解析，拼接文件路径并写入响应头。对比：
+//   memset - 旧实现：每个请求 resize + memset 2KB 读缓冲区、1KB 写缓冲区
+//            和 200B 文件路径，再复制文档根目录
+//   pooled - 现实现：只重置长度与视图，读写缓冲区按需从内存池取块、
+//            发完即归还，文档根目录在建立连接时写入一次
+// 分别测量单个连接反复请求（缓冲区常驻缓存）和轮流服务 1024 个连接
+// 两种情况，输出每个请求的纳秒数和 TSC 周期数，reset 列只含重置本身
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TINYWEBSERVER_HAS_TSC 1
+#endif
+
+#include "http/buffer_pool.h"
+#include "http/http_parser.h"
+
+namespace tinywebserver {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kIterations = 1000000;
+constexpr size_t kLegacyReadSize = 2048;
+constexpr size_t kLegacyWriteSize = 1024;
+constexpr size_t kFileNameLen = 200;
+constexpr const char* kDocRoot = "/home/tinywebserver/root";
+
+const std::string kRequest =
+    "GET /judge.html HTTP/1.1\r\n"
+    "Host: 192.168.1.20:9006\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+    "image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+
+uint64_t ReadTsc() {
+#ifdef TINYWEBSERVER_HAS_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// 每个请求的请求状态字段，两种实现相同
+struct RequestState {
+  std::string_view url;
+  std::string_view host;
+  std::string_view range;
+  std::string_view if_none_match;
+  std::string_view accept_encoding;
+  bool linger{false};
+  int cgi{0};
+  int range_count{0};
+
+  void Reset() { *this = RequestState{}; }
+};
+
+size_t g_sink = 0;
+
+// 解析请求并写入响应头，返回响应头长度
+size_t HandleRequest(HttpRequestParser* parser, const char* read_buf,
+                     size_t read_idx, RequestState* state, char* real_file,
+                     size_t root_len, char* write_buf, size_t write_size) {
+  if (parser->Parse(read_buf, read_idx) !=
+      HttpRequestParser::Status::kComplete) {
+    return 0;
+  }
+  state->url = parser->target();
+  state->host = parser->FindHeader("Host");
+  state->accept_encoding = parser->FindHeader("Accept-Encoding");
+  state->linger = parser->FindHeader("Connection") == "keep-alive";
+  size_t n = std::min(state->url.size(), kFileNameLen - root_len - 1);
+  memcpy(real_file + root_len, state->url.data(), n);
+  real_file[root_len + n] = '\0';
+  int len = snprintf(write_buf, write_size,
+                     "HTTP/1.1 200 OK\r\nContent-Length:%d\r\n"
+                     "Connection:%s\r\n\r\n",
+                     1676, state->linger ? "keep-alive" : "close");
+  return len > 0 ? static_cast<size_t>(len) : 0;
+}
+
+class LegacyConnection {
+ public:
+  // 旧 init()：每个请求都清零全部缓冲区
+  void Reset() {
+    parser_.Reset();
+    state_.Reset();
+    read_idx_ = 0;
+    read_buf_.resize(kLegacyReadSize);
+    memset(&read_buf_[0], '\0', kLegacyReadSize);
+    write_buf_.resize(kLegacyWriteSize);
+    memset(&write_buf_[0], '\0', kLegacyWriteSize);
+    real_file_.resize(kFileNameLen);
+    memset(&real_file_[0], '\0', kFileNameLen);
+  }
+
+  void Serve() {
+    memcpy(&read_buf_[0], kRequest.data(), kRequest.size());
+    read_idx_ = kRequest.size();
+    strcpy(&real_file_[0], kDocRoot);
+    g_sink += HandleRequest(&parser_, &read_buf_[0], read_idx_, &state_,
+                            &real_file_[0], strlen(kDocRoot), &write_buf_[0],
+                            kLegacyWriteSize);
+  }
+
+  void Release() {}
+
+ private:
+  HttpRequestParser parser_;
+  RequestState state_;
+  std::vector<char> read_buf_;
+  size_t read_idx_{0};
+  std::vector<char> write_buf_;
+  std::vector<char> real_file_;
+};
+
+class PooledConnection {
+ public:
+  PooledConnection() {
+    // 文档根目录在建立连接时写入一次
+    real_file_.resize(kFileNameLen);
+    root_len_ = strlen(kDocRoot);
+    memcpy(&real_file_[0], kDocRoot, root_len_ + 1);
+  }
+
+  void Reset() {
+    parser_.Reset();
+    state_.Reset();
+    read_idx_ = 0;
+  }
+
+  void Serve() {
+    read_buf_.Allocate(BufferPool::kChunkSize);
+    memcpy(read_buf_.data(), kRequest.data(), kRequest.size());
+    read_idx_ = kRequest.size();
+    write_buf_.Allocate(BufferPool::kChunkSize);
+    g_sink += HandleRequest(&parser_, read_buf_.data(), read_idx_, &state_,
+                            &real_file_[0], root_len_, write_buf_.data(),
+                            BufferPool::kChunkSize);
+  }
+
+  // 响应发完、连接空闲，缓冲区归还内存池
+  void Release() {
+    read_buf_.Reset();
+    write_buf_.Reset();
+  }
+
+ private:
+  HttpRequestParser parser_;
+  RequestState state_;
+  PooledBuffer read_buf_;
+  size_t read_idx_{0};
+  PooledBuffer write_buf_;
+  std::vector<char> real_file_;
+  size_t root_len_{0};
+};
+
+struct Result {
+  double reset_ns;
+  double reset_cycles;
+  double request_ns;
+  double request_cycles;
+};
+
+double NsSince(Clock::time_point start) {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                           start)
+          .count());
+}
+
+// @param connections 轮流服务的连接数
+template <typename Connection>
+Result Bench(size_t connections) {
+  std::vector<std::unique_ptr<Connection>> conns;
+  for (size_t i = 0; i < connections; ++i) {
+    conns.push_back(std::make_unique<Connection>());
+    conns.back()->Reset();
+    conns.back()->Serve();
+    conns.back()->Release();
+  }
+
+  // 只测重置
+  auto start = Clock::now();
+  uint64_t tsc = ReadTsc();
+  for (int i = 0; i < kIterations; ++i) {
+    conns[static_cast<size_t>(i) % connections]->Reset();
+  }
+  uint64_t reset_tsc = ReadTsc() - tsc;
+  double reset_ns = NsSince(start);
+
+  // 完整请求周期
+  start = Clock::now();
+  tsc = ReadTsc();
+  for (int i = 0; i < kIterations; ++i) {
+    Connection& conn = *conns[static_cast<size_t>(i) % connections];
+    conn.Reset();
+    conn.Serve();
+    conn.Release();
+  }
+  uint64_t request_tsc = ReadTsc() - tsc;
+  double request_ns = NsSince(start);
+
+  return Result{reset_ns / kIterations,
+                static_cast<double>(reset_tsc) / kIterations,
+                request_ns / kIterations,
+                static_cast<double>(request_tsc) / kIterations};
+}
+
+void Report(const char* name, size_t connections, const Result& result) {
+  std::printf("%-8s %6zu %12.1f %14.1f %12.1f %14.1f\n", name, connections,
+              result.reset_ns, result.reset_cycles, result.request_ns,
+              result.request_cycles);
+}
+
+}  // namespace
+}  // namespace tinywebserver
+
+int main() {
+  using tinywebserver::Bench;
+  using tinywebserver::LegacyConnection;
+  using tinywebserver::PooledConnection;
+  using tinywebserver::Report;
+#ifndef TINYWEBSERVER_HAS_TSC
+  std::printf("TSC unavailable, cycle columns are 0\n");
+#endif
+  std::printf("%-8s %6s %12s %14s %12s %14s\n", "impl", "conns", "reset ns",
+              "reset cycles", "request ns", "request cycles");
+  for (size_t connections : {static_cast<size_t>(1), static_cast<size_t>(1024)}) {
+    Report("memset", connections, Bench<LegacyConnection>(connections));
+    Report("pooled", connections, Bench<PooledConnection>(connections));
+  }
+  std::printf("(sink %zu)\n", tinywebserver::g_sink);
+  return 0;
+}
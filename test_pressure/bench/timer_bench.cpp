@@ -0,0 +1,151 @@
+// Copyright 2025 TinyWebServer
+// 连接定时器基准测试：SortedTimerList 与 TimingWheel
+// 遵循 Google C++ 编码规范
+//
+// 模拟 N 个空闲长连接各自持有 15 秒超时的定时器，测量：
+//   add    - 新连接加入（到期时间晚于所有已有定时器）
+//   adjust - 随机连接收到请求后延长超时
+//   tick   - 一次性让所有定时器到期
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "timer/lst_timer.h"
+
+namespace tinywebserver {
+
+// TimerCallback 引用的 http 模块符号，基准中不需要
+void DecrementHttpUserCount() {}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSampleOps = 10000;
+constexpr auto kTimeout = std::chrono::seconds(15);
+
+double NsPerOp(Clock::time_point start, int ops) {
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start)
+                .count();
+  return static_cast<double>(ns) / ops;
+}
+
+int g_expired = 0;
+
+void CountExpired(ClientData*) { ++g_expired; }
+
+// 用于生成随机连接下标的固定种子序列
+std::vector<size_t> RandomIndices(size_t connections) {
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<size_t> dist(0, connections - 1);
+  std::vector<size_t> indices(kSampleOps);
+  for (auto& index : indices) {
+    index = dist(rng);
+  }
+  return indices;
+}
+
+void BenchSortedList(size_t connections) {
+  const auto base = Clock::now();
+  const auto indices = RandomIndices(connections);
+  SortedTimerList list;
+  std::vector<Timer*> timers(connections);
+
+  // 逆序插入，使初始构建每次都落在表头，不计入测量
+  for (size_t i = connections; i-- > 0;) {
+    timers[i] = new Timer;
+    timers[i]->expire_time_ = base + kTimeout + std::chrono::microseconds(i);
+    timers[i]->callback_ = CountExpired;
+    list.AddTimer(timers[i]);
+  }
+
+  auto offset = std::chrono::microseconds(connections);
+  auto start = Clock::now();
+  for (int i = 0; i < kSampleOps; ++i) {
+    Timer* timer = new Timer;
+    timer->expire_time_ = base + kTimeout + offset + std::chrono::microseconds(i);
+    list.AddTimer(timer);
+    list.DeleteTimer(timer);
+  }
+  double add_ns = NsPerOp(start, kSampleOps);
+
+  start = Clock::now();
+  for (int i = 0; i < kSampleOps; ++i) {
+    Timer* timer = timers[indices[static_cast<size_t>(i)]];
+    timer->expire_time_ = base + kTimeout + offset + std::chrono::microseconds(i);
+    list.AdjustTimer(timer);
+  }
+  double adjust_ns = NsPerOp(start, kSampleOps);
+
+  // SortedTimerList::Tick 使用当前时间，这里把所有定时器提前到已过期
+  for (Timer* timer : timers) {
+    timer->expire_time_ = base;
+  }
+  g_expired = 0;
+  start = Clock::now();
+  list.Tick();
+  double tick_ns = NsPerOp(start, static_cast<int>(connections));
+
+  std::printf("%-14s %8zu %12.1f %12.1f %12.1f %10d\n", "sorted list",
+              connections, add_ns, adjust_ns, tick_ns, g_expired);
+}
+
+void BenchTimingWheel(size_t connections) {
+  const auto base = Clock::now();
+  const auto indices = RandomIndices(connections);
+  TimingWheel wheel;
+  std::vector<Timer> timers(connections);
+  std::vector<ClientData> clients(connections);
+  Timer extra;
+
+  for (size_t i = 0; i < connections; ++i) {
+    timers[i].expire_time_ = base + kTimeout + std::chrono::microseconds(i);
+    timers[i].callback_ = CountExpired;
+    timers[i].user_data_ = &clients[i];
+    clients[i].timer = &timers[i];
+    wheel.AddTimer(&timers[i]);
+  }
+
+  auto offset = std::chrono::microseconds(connections);
+  auto start = Clock::now();
+  for (int i = 0; i < kSampleOps; ++i) {
+    extra.expire_time_ = base + kTimeout + offset + std::chrono::microseconds(i);
+    wheel.AddTimer(&extra);
+    wheel.DeleteTimer(&extra);
+  }
+  double add_ns = NsPerOp(start, kSampleOps);
+
+  start = Clock::now();
+  for (int i = 0; i < kSampleOps; ++i) {
+    Timer& timer = timers[indices[static_cast<size_t>(i)]];
+    timer.expire_time_ = base + kTimeout + offset + std::chrono::microseconds(i);
+    wheel.AdjustTimer(&timer);
+  }
+  double adjust_ns = NsPerOp(start, kSampleOps);
+
+  g_expired = 0;
+  start = Clock::now();
+  wheel.Tick(base + 2 * kTimeout + offset + std::chrono::seconds(1));
+  double tick_ns = NsPerOp(start, static_cast<int>(connections));
+
+  std::printf("%-14s %8zu %12.1f %12.1f %12.1f %10d\n", "timing wheel",
+              connections, add_ns, adjust_ns, tick_ns, g_expired);
+}
+
+}  // namespace
+}  // namespace tinywebserver
+
+int main() {
+  std::printf("%-14s %8s %12s %12s %12s %10s\n", "timer", "conns", "add ns/op",
+              "adjust ns/op", "tick ns/tmr", "expired");
+  for (size_t connections : {size_t{1000}, size_t{10000}, size_t{100000}}) {
+    tinywebserver::BenchSortedList(connections);
+    tinywebserver::BenchTimingWheel(connections);
+  }
+  return 0;
+}
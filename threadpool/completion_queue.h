@@ -0,0 +1,111 @@
+// Copyright 2025 TinyWebServer
+// 工作线程向事件循环回传处理结果的多生产者单消费者队列
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_THREADPOOL_COMPLETION_QUEUE_H_
+#define TINYWEBSERVER_THREADPOOL_COMPLETION_QUEUE_H_
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "mpsc_ring.h"
+
+namespace tinywebserver {
+
+// 工作线程处理完一个连接后请求事件循环执行的动作
+enum class CompletionType {
+  kAdjustTimer = 0,  // 连接仍然活跃，延长其定时器
+  kClose             // 连接需要关闭并移除定时器
+};
+
+// 单条完成通知
+struct Completion {
+  int sockfd{-1};
+  CompletionType type{CompletionType::kAdjustTimer};
+};
+
+// 由 eventfd 驱动的有界无锁 MPSC 队列。
+// 工作线程 Push 完成通知，事件循环在 eventfd 可读时 Drain。
+// 连续的 Push 只会触发一次 eventfd 写入，直到消费者再次开始 Drain。
+class CompletionQueue {
+ public:
+  // 构造完成队列。
+  // @param capacity 队列容量，会向上取整为 2 的幂
+  // @throws std::runtime_error 如果无法创建 eventfd
+  explicit CompletionQueue(size_t capacity)
+      : ring_(capacity),
+        notified_(false),
+        event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (event_fd_ < 0) {
+      throw std::runtime_error("CompletionQueue: eventfd creation failed");
+    }
+  }
+
+  ~CompletionQueue() {
+    if (event_fd_ >= 0) {
+      close(event_fd_);
+    }
+  }
+
+  // 禁用拷贝和移动操作
+  CompletionQueue(const CompletionQueue&) = delete;
+  CompletionQueue& operator=(const CompletionQueue&) = delete;
+  CompletionQueue(CompletionQueue&&) = delete;
+  CompletionQueue& operator=(CompletionQueue&&) = delete;
+
+  // 返回需要注册到 epoll 的 eventfd
+  int fd() const { return event_fd_; }
+
+  // 投递一条完成通知（任意线程调用）。
+  // @param completion 完成通知
+  // @return 如果队列已满返回 false
+  bool Push(const Completion& completion) {
+    if (!ring_.TryPush(completion)) {
+      return false;
+    }
+
+    // 只有第一个生产者负责唤醒事件循环
+    if (!notified_.exchange(true, std::memory_order_seq_cst)) {
+      uint64_t one = 1;
+      ssize_t n = write(event_fd_, &one, sizeof(one));
+      (void)n;
+    }
+    return true;
+  }
+
+  // 取出所有完成通知（仅事件循环线程调用）。
+  // @param handler 对每条通知调用的函数
+  // @return 处理的通知数量
+  template <typename Handler>
+  size_t Drain(Handler&& handler) {
+    uint64_t counter = 0;
+    ssize_t n = read(event_fd_, &counter, sizeof(counter));
+    (void)n;
+
+    // 先清除通知标志再读取，保证之后入队的生产者会重新写 eventfd；
+    // 使用 RMW 与生产者的 exchange 同步，确保此前入队的数据可见
+    notified_.exchange(false, std::memory_order_acq_rel);
+
+    size_t count = 0;
+    Completion completion;
+    while (ring_.TryPop(completion)) {
+      handler(completion);
+      ++count;
+    }
+    return count;
+  }
+
+ private:
+  MpscRing<Completion> ring_;
+  alignas(64) std::atomic<bool> notified_;  // eventfd 是否已被写入
+  int event_fd_;
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_THREADPOOL_COMPLETION_QUEUE_H_
@@ -0,0 +1,115 @@
+// Copyright 2025 TinyWebServer
+// 有界无锁多生产者单消费者环形队列
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_THREADPOOL_MPSC_RING_H_
+#define TINYWEBSERVER_THREADPOOL_MPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace tinywebserver {
+
+// 有界无锁 MPSC 环形队列（Vyukov 有界队列）。
+// 每个槽位带序号，生产者之间通过 CAS 争用写位置，
+// 消费者独占读位置，因此入队和出队都不需要加锁，也不分配内存。
+// @tparam T 元素类型，必须可平凡拷贝
+template <typename T>
+class MpscRing {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "MpscRing elements must be trivially copyable");
+
+ public:
+  // 构造环形队列。
+  // @param capacity 队列容量，会向上取整为 2 的幂
+  explicit MpscRing(size_t capacity)
+      : mask_(RoundUpPowerOfTwo(capacity) - 1),
+        cells_(new Cell[mask_ + 1]),
+        enqueue_pos_(0),
+        dequeue_pos_(0) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpscRing() = default;
+
+  // 禁用拷贝和移动操作
+  MpscRing(const MpscRing&) = delete;
+  MpscRing& operator=(const MpscRing&) = delete;
+  MpscRing(MpscRing&&) = delete;
+  MpscRing& operator=(MpscRing&&) = delete;
+
+  // 入队（任意线程调用）。
+  // @param item 要入队的元素
+  // @return 如果队列已满返回 false
+  bool TryPush(const T& item) {
+    Cell* cell = nullptr;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 出队（仅消费者线程调用）。
+  // @param item 输出参数，用于存储出队的元素
+  // @return 如果队列为空返回 false
+  bool TryPop(T& item) {
+    Cell* cell = &cells_[dequeue_pos_ & mask_];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (seq != dequeue_pos_ + 1) {
+      return false;
+    }
+    item = cell->data;
+    cell->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_pos_;
+    return true;
+  }
+
+  // 检查队列是否可能为空（仅消费者线程调用）。
+  bool Empty() const {
+    const Cell& cell = cells_[dequeue_pos_ & mask_];
+    return cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence{0};
+    T data{};
+  };
+
+  static size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;  // 生产者共享的写位置
+  alignas(64) size_t dequeue_pos_;               // 消费者独占的读位置
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_THREADPOOL_MPSC_RING_H_
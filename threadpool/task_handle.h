@@ -0,0 +1,51 @@
+// Copyright 2025 TinyWebServer
+// 线程池任务句柄：连接指针与事件类型打包为一个机器字
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_THREADPOOL_TASK_HANDLE_H_
+#define TINYWEBSERVER_THREADPOOL_TASK_HANDLE_H_
+
+#include <cstdint>
+
+namespace tinywebserver {
+
+// 派发给工作线程的事件类型
+enum class TaskEvent : uint8_t {
+  kProcess = 0,  // Proactor：数据已由事件循环读入，只需解析并生成响应
+  kRead = 1,     // Reactor：由工作线程读取并处理
+  kWrite = 2     // Reactor：由工作线程写出响应
+};
+
+// 侵入式任务句柄。
+// 连接对象由服务器持有，句柄只引用它，不参与生命周期管理；
+// 事件类型保存在指针的低位（连接对象至少 4 字节对齐），
+// 因此句柄可平凡拷贝、无需堆分配，并且可以作为无锁原子量在队列中传递。
+// @tparam T 连接类型
+template <typename T>
+class TaskHandle {
+  static_assert(alignof(T) >= 4, "TaskHandle needs two free pointer bits");
+
+ public:
+  TaskHandle() = default;
+
+  TaskHandle(T* request, TaskEvent event)
+      : bits_(reinterpret_cast<uintptr_t>(request) |
+              static_cast<uintptr_t>(event)) {}
+
+  T* request() const { return reinterpret_cast<T*>(bits_ & ~kEventMask); }
+
+  TaskEvent event() const {
+    return static_cast<TaskEvent>(bits_ & kEventMask);
+  }
+
+  explicit operator bool() const { return bits_ != 0; }
+
+ private:
+  static constexpr uintptr_t kEventMask = 0x3;
+
+  uintptr_t bits_{0};
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_THREADPOOL_TASK_HANDLE_H_
@@ -11,29 +11,34 @@
 #include <exception>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <stdexcept>
 #include <thread>
 #include <vector>
 
-#include "../CGImysql/sql_connection_pool.h"
+#include "completion_queue.h"
+#include "task_handle.h"
+#include "work_stealing.h"
 
 namespace tinywebserver {
 
 // 用于处理并发请求的线程池模板类。
-// 使用生产者-消费者模式与工作队列。
+// 默认使用生产者-消费者模式与互斥锁保护的工作队列；
+// 也可以选择无锁的工作窃取调度器（见 work_stealing.h）。
+// 两种队列都只传递 TaskHandle（请求指针 + 事件类型），派发过程不做堆分配；
+// 请求对象的生命周期由调用方保证。工作线程不持有数据库连接，
+// 需要数据库的请求处理函数自行从连接池获取。
 // @tparam T 要处理的任务/请求类型
 template <typename T>
 class ThreadPool {
  public:
   // 构造线程池。
   // @param actor_model 并发模型 (0=Proactor, 1=Reactor)
-  // @param conn_pool 数据库连接池
   // @param thread_number 工作线程数量
   // @param max_requests 队列中最大待处理请求数
+  // @param work_stealing 是否使用无锁工作窃取调度器
   // @throws std::invalid_argument 如果参数无效
-  ThreadPool(int actor_model, ConnectionPool* conn_pool, int thread_number = 8,
-             int max_requests = 10000);
+  ThreadPool(int actor_model, int thread_number = 8, int max_requests = 10000,
+             bool work_stealing = false);
 
   ~ThreadPool();
 
@@ -44,53 +49,75 @@ class ThreadPool {
   ThreadPool& operator=(ThreadPool&&) = delete;
 
   // 向工作队列添加请求 (Reactor 模式)。
-  // @param request 指向请求的共享指针
+  // @param request 指向请求的指针
   // @param state 请求状态 (0=读, 1=写)
   // @return 如果请求成功入队返回 true，否则返回 false
-  bool Append(std::shared_ptr<T> request, int state);
+  bool Append(T* request, int state);
 
   // 向工作队列添加请求 (Proactor 模式)。
-  // @param request 指向请求的共享指针
+  // @param request 指向请求的指针
   // @return 如果请求成功入队返回 true，否则返回 false
-  bool AppendProactor(std::shared_ptr<T> request);
+  bool AppendProactor(T* request);
 
  private:
   // 工作线程函数。
   // 持续处理工作队列中的请求。
   void Run();
 
+  // 工作窃取模式下的工作线程函数。
+  // @param index 工作线程编号
+  void RunWorkStealing(int index);
+
+  // 处理单个任务，并把结果投递回事件循环。
+  void Process(TaskHandle<T> task);
+
+  // 将任务放入当前调度器的队列。
+  bool Enqueue(TaskHandle<T> task);
+
   int thread_number_;                       // 线程数量
   int max_requests_;                        // 最大待处理请求数
   std::vector<std::thread> threads_;        // 工作线程数组
-  std::queue<std::shared_ptr<T>> work_queue_;  // 请求队列
+  std::vector<TaskHandle<T>> work_queue_;   // 预分配的环形请求队列
+  size_t queue_head_;                       // 队头位置
+  size_t queue_size_;                       // 队列中的任务数
   std::mutex queue_mutex_;                  // 队列保护互斥锁
   std::condition_variable queue_cond_;      // 信号通知条件变量
-  ConnectionPool* conn_pool_;               // 数据库连接池
   int actor_model_;                         // 并发模型
   std::atomic<bool> stop_;                  // 停止标志
+  std::unique_ptr<WorkStealingScheduler<TaskHandle<T>>> scheduler_;  // 工作窃取调度器
 };
 
 // 模板实现
 
 template <typename T>
-ThreadPool<T>::ThreadPool(int actor_model, ConnectionPool* conn_pool,
-                          int thread_number, int max_requests)
+ThreadPool<T>::ThreadPool(int actor_model, int thread_number,
+                          int max_requests, bool work_stealing)
     : actor_model_(actor_model),
       thread_number_(thread_number),
       max_requests_(max_requests),
-      conn_pool_(conn_pool),
+      queue_head_(0),
+      queue_size_(0),
       stop_(false) {
   if (thread_number <= 0 || max_requests <= 0) {
     throw std::invalid_argument(
         "ThreadPool: thread_number and max_requests must be positive");
   }
 
-  if (conn_pool == nullptr) {
-    throw std::invalid_argument("ThreadPool: conn_pool cannot be null");
-  }
-
   threads_.reserve(thread_number_);
 
+  if (work_stealing) {
+    // 每个工作线程的收件环平分最大待处理请求数
+    size_t inbox_capacity = static_cast<size_t>(
+        (max_requests + thread_number - 1) / thread_number);
+    scheduler_ = std::make_unique<WorkStealingScheduler<TaskHandle<T>>>(
+        thread_number, inbox_capacity);
+    for (int i = 0; i < thread_number; ++i) {
+      threads_.emplace_back([this, i]() { this->RunWorkStealing(i); });
+    }
+    return;
+  }
+
+  work_queue_.resize(static_cast<size_t>(max_requests_));
   for (int i = 0; i < thread_number; ++i) {
     threads_.emplace_back([this]() { this->Run(); });
   }
@@ -99,6 +126,9 @@ ThreadPool<T>::ThreadPool(int actor_model, ConnectionPool* conn_pool,
 template <typename T>
 ThreadPool<T>::~ThreadPool() {
   stop_ = true;
+  if (scheduler_) {
+    scheduler_->Stop();
+  }
   queue_cond_.notify_all();
 
   for (auto& thread : threads_) {
@@ -109,38 +139,38 @@ ThreadPool<T>::~ThreadPool() {
 }
 
 template <typename T>
-bool ThreadPool<T>::Append(std::shared_ptr<T> request, int state) {
+bool ThreadPool<T>::Append(T* request, int state) {
   if (!request) {
     return false;
   }
 
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    if (work_queue_.size() >= static_cast<size_t>(max_requests_)) {
-      return false;
-    }
+  return Enqueue(TaskHandle<T>(
+      request, state == 0 ? TaskEvent::kRead : TaskEvent::kWrite));
+}
 
-    request->m_state = state;
-    work_queue_.push(request);
+template <typename T>
+bool ThreadPool<T>::AppendProactor(T* request) {
+  if (!request) {
+    return false;
   }
 
-  queue_cond_.notify_one();
-  return true;
+  return Enqueue(TaskHandle<T>(request, TaskEvent::kProcess));
 }
 
 template <typename T>
-bool ThreadPool<T>::AppendProactor(std::shared_ptr<T> request) {
-  if (!request) {
-    return false;
+bool ThreadPool<T>::Enqueue(TaskHandle<T> task) {
+  if (scheduler_) {
+    return scheduler_->Submit(task);
   }
 
   {
     std::lock_guard<std::mutex> lock(queue_mutex_);
-    if (work_queue_.size() >= static_cast<size_t>(max_requests_)) {
+    if (queue_size_ >= work_queue_.size()) {
       return false;
     }
 
-    work_queue_.push(request);
+    work_queue_[(queue_head_ + queue_size_) % work_queue_.size()] = task;
+    ++queue_size_;
   }
 
   queue_cond_.notify_one();
@@ -150,56 +180,72 @@ bool ThreadPool<T>::AppendProactor(std::shared_ptr<T> request) {
 template <typename T>
 void ThreadPool<T>::Run() {
   while (!stop_) {
-    std::shared_ptr<T> request;
+    TaskHandle<T> task;
     {
       std::unique_lock<std::mutex> lock(queue_mutex_);
-      queue_cond_.wait(lock,
-                       [this]() { return stop_ || !work_queue_.empty(); });
+      queue_cond_.wait(lock, [this]() { return stop_ || queue_size_ != 0; });
 
-      if (stop_ && work_queue_.empty()) {
+      if (stop_ && queue_size_ == 0) {
         break;
       }
 
-      if (!work_queue_.empty()) {
-        request = work_queue_.front();
-        work_queue_.pop();
+      if (queue_size_ != 0) {
+        task = work_queue_[queue_head_];
+        queue_head_ = (queue_head_ + 1) % work_queue_.size();
+        --queue_size_;
       }
     }
 
-    if (!request) {
+    if (!task) {
       continue;
     }
 
-    try {
-      if (actor_model_ == 1) {
-        // Reactor 模式：处理读/写事件
-        if (request->m_state == 0) {
-          // 读事件
-          if (request->read_once()) {
-            request->improv = 1;
-            ConnectionRAII mysql_conn(&request->mysql, conn_pool_);
-            request->process();
-          } else {
-            request->improv = 1;
-            request->timer_flag = 1;
-          }
-        } else {
-          // 写事件
-          if (request->write()) {
-            request->improv = 1;
-          } else {
-            request->improv = 1;
-            request->timer_flag = 1;
-          }
+    Process(task);
+  }
+}
+
+template <typename T>
+void ThreadPool<T>::RunWorkStealing(int index) {
+  TaskHandle<T> task;
+  while (scheduler_->Next(index, task)) {
+    Process(task);
+  }
+}
+
+template <typename T>
+void ThreadPool<T>::Process(TaskHandle<T> task) {
+  T* request = task.request();
+  try {
+    if (task.event() != TaskEvent::kProcess) {
+      // Reactor 模式：处理读/写事件，结果通过完成队列交回事件循环
+      bool keep_alive = false;
+      if (task.event() == TaskEvent::kRead) {
+        // 读事件
+        if (request->read_once()) {
+          keep_alive = request->process();
         }
       } else {
-        // Proactor 模式：处理请求
-        ConnectionRAII mysql_conn(&request->mysql, conn_pool_);
-        request->process();
+        // 写事件；发完后若已有完整的流水线请求，接着处理
+        keep_alive = request->write();
+        if (keep_alive && request->HasBufferedRequest()) {
+          keep_alive = request->process();
+        }
       }
-    } catch (const std::exception& e) {
-      std::fprintf(stderr, "Thread pool task exception: %s\n", e.what());
+      request->PostCompletion(keep_alive ? CompletionType::kAdjustTimer
+                                         : CompletionType::kClose);
+    } else {
+      // Proactor 模式：处理请求
+      bool keep_alive = request->process();
+      request->PostCompletion(keep_alive ? CompletionType::kAdjustTimer
+                                         : CompletionType::kClose);
     }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "Thread pool task exception: %s\n", e.what());
+    // 仍需交回事件循环关闭连接，否则 pending_tasks 不归零，连接永远不会被关闭
+    request->PostCompletion(CompletionType::kClose);
+  } catch (...) {
+    std::fprintf(stderr, "Thread pool task exception: unknown\n");
+    request->PostCompletion(CompletionType::kClose);
   }
 }
 
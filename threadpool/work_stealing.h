@@ -0,0 +1,323 @@
+// Copyright 2025 TinyWebServer
+// 无锁工作窃取调度器：Chase-Lev 双端队列 + 每线程收件环 + 自适应休眠
+// 遵循 Google C++ 编码规范
+
+#ifndef TINYWEBSERVER_THREADPOOL_WORK_STEALING_H_
+#define TINYWEBSERVER_THREADPOOL_WORK_STEALING_H_
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "mpsc_ring.h"
+
+namespace tinywebserver {
+
+// 有界 Chase-Lev 工作窃取双端队列。
+// 所有者线程在底部 Push/Pop，其他线程在顶部 Steal。
+// 实现参照 Lê 等人的 C11 内存模型版本（PPoPP 2013）。
+// @tparam T 元素类型，必须可平凡拷贝且其 std::atomic 无锁
+template <typename T>
+class ChaseLevDeque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "ChaseLevDeque elements must be trivially copyable");
+  static_assert(std::atomic<T>::is_always_lock_free,
+                "ChaseLevDeque elements must be lock-free atomics");
+
+ public:
+  // @param capacity 容量，会向上取整为 2 的幂
+  explicit ChaseLevDeque(size_t capacity)
+      : mask_(RoundUpPowerOfTwo(capacity) - 1),
+        buffer_(new std::atomic<T>[mask_ + 1]),
+        top_(0),
+        bottom_(0) {}
+
+  // 禁用拷贝和移动操作
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+  ChaseLevDeque(ChaseLevDeque&&) = delete;
+  ChaseLevDeque& operator=(ChaseLevDeque&&) = delete;
+
+  // 在底部压入元素（仅所有者线程调用）。
+  // @return 如果队列已满返回 false
+  bool Push(const T& item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t > static_cast<int64_t>(mask_)) {
+      return false;
+    }
+    buffer_[static_cast<size_t>(b) & mask_].store(item,
+                                                  std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // 从底部弹出元素（仅所有者线程调用）。
+  // @return 如果队列为空或最后一个元素被窃取返回 false
+  bool Pop(T& item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    item = buffer_[static_cast<size_t>(b) & mask_].load(
+        std::memory_order_relaxed);
+    if (t == b) {
+      // 最后一个元素，与窃取者竞争
+      bool won = top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // 从顶部窃取元素（任意线程调用）。
+  // @return 如果队列为空或与其他线程竞争失败返回 false
+  bool Steal(T& item) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+
+    item = buffer_[static_cast<size_t>(t) & mask_].load(
+        std::memory_order_relaxed);
+    return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed);
+  }
+
+  // 检查队列是否已满（仅所有者线程调用）。
+  // 窃取只会腾出空间，因此所有者看到未满时 Push 一定成功。
+  bool Full() const {
+    return bottom_.load(std::memory_order_relaxed) -
+               top_.load(std::memory_order_acquire) >
+           static_cast<int64_t>(mask_);
+  }
+
+  // 检查队列是否可能为空（任意线程调用，结果仅供参考）。
+  bool Empty() const {
+    return top_.load(std::memory_order_acquire) >=
+           bottom_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<std::atomic<T>[]> buffer_;
+  alignas(64) std::atomic<int64_t> top_;     // 窃取端
+  alignas(64) std::atomic<int64_t> bottom_;  // 所有者端
+};
+
+// 工作窃取调度器。
+// 生产者（事件循环）把任务轮询投递到各工作线程的有界无锁收件环；
+// 工作线程把收件环中的任务批量搬入自己的 Chase-Lev 双端队列后处理，
+// 空闲时从其他线程的双端队列顶部窃取。没有任务时先自旋，再通过 futex 休眠，
+// 投递任务时只有目标线程处于休眠状态才会触发 futex 唤醒系统调用。
+// @tparam Task 任务类型，必须可平凡拷贝且其 std::atomic 无锁
+template <typename Task>
+class WorkStealingScheduler {
+ public:
+  // 构造调度器。
+  // @param worker_count 工作线程数量
+  // @param inbox_capacity 每个工作线程收件环的容量
+  WorkStealingScheduler(int worker_count, size_t inbox_capacity)
+      : next_worker_(0), stop_(false) {
+    workers_.reserve(static_cast<size_t>(worker_count));
+    for (int i = 0; i < worker_count; ++i) {
+      workers_.push_back(std::make_unique<Worker>(inbox_capacity));
+    }
+  }
+
+  // 禁用拷贝和移动操作
+  WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+  WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+  WorkStealingScheduler(WorkStealingScheduler&&) = delete;
+  WorkStealingScheduler& operator=(WorkStealingScheduler&&) = delete;
+
+  // 投递任务（任意线程调用）。
+  // @param task 要投递的任务
+  // @return 如果所有收件环都已满返回 false
+  bool Submit(const Task& task) {
+    const size_t count = workers_.size();
+    size_t start =
+        next_worker_.fetch_add(1, std::memory_order_relaxed) % count;
+    for (size_t i = 0; i < count; ++i) {
+      Worker& worker = *workers_[(start + i) % count];
+      if (worker.inbox.TryPush(task)) {
+        // 与工作线程休眠前的检查构成 Dekker 式同步，避免丢失唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Wake(worker);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 取得下一个任务（仅第 index 个工作线程调用），没有任务时阻塞。
+  // @param index 工作线程编号
+  // @param task 输出参数，用于存储取得的任务
+  // @return 调度器停止时返回 false
+  bool Next(int index, Task& task) {
+    Worker& self = *workers_[static_cast<size_t>(index)];
+    while (true) {
+      for (int spin = 0; spin < kSpinRounds; ++spin) {
+        if (TryNext(self, index, task)) {
+          return true;
+        }
+        if (stop_.load(std::memory_order_acquire)) {
+          return false;
+        }
+        if (spin >= kSpinRounds / 2) {
+          std::this_thread::yield();
+        }
+      }
+
+      // 宣告休眠后再检查一次，防止与 Submit 之间丢失唤醒
+      self.state.store(kParked, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!self.inbox.Empty() || AnyStealable() ||
+          stop_.load(std::memory_order_seq_cst)) {
+        self.state.store(kRunning, std::memory_order_relaxed);
+        continue;
+      }
+      FutexWait(self.state, kParked);
+      self.state.store(kRunning, std::memory_order_relaxed);
+    }
+  }
+
+  // 停止调度器并唤醒所有工作线程。
+  void Stop() {
+    stop_.store(true, std::memory_order_seq_cst);
+    for (auto& worker : workers_) {
+      worker->state.store(kRunning, std::memory_order_seq_cst);
+      FutexWake(worker->state);
+    }
+  }
+
+ private:
+  static constexpr uint32_t kRunning = 0;
+  static constexpr uint32_t kParked = 1;
+  static constexpr int kSpinRounds = 64;       // 休眠前的自旋轮数
+  static constexpr size_t kRefillBatch = 32;   // 每次从收件环搬运的最大任务数
+
+  struct Worker {
+    explicit Worker(size_t inbox_capacity)
+        : inbox(inbox_capacity), deque(inbox_capacity), state(kRunning) {}
+
+    MpscRing<Task> inbox;                  // 生产者投递的任务
+    ChaseLevDeque<Task> deque;             // 本线程待处理、可被窃取的任务
+    alignas(64) std::atomic<uint32_t> state;  // futex 字
+  };
+
+  // 依次尝试：本地双端队列、收件环、窃取其他线程
+  bool TryNext(Worker& self, int index, Task& task) {
+    if (self.deque.Pop(task)) {
+      return true;
+    }
+    if (Refill(self, task)) {
+      return true;
+    }
+    return TrySteal(index, task);
+  }
+
+  // 把收件环中的任务搬入本地双端队列，直接返回第一个任务
+  bool Refill(Worker& self, Task& task) {
+    if (!self.inbox.TryPop(task)) {
+      return false;
+    }
+    size_t moved = 0;
+    Task extra;
+    while (moved < kRefillBatch && !self.deque.Full() &&
+           self.inbox.TryPop(extra)) {
+      self.deque.Push(extra);
+      ++moved;
+    }
+    // 搬入了额外任务，唤醒一个休眠的线程来窃取
+    if (moved > 0) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      WakeOneParked();
+    }
+    return true;
+  }
+
+  bool TrySteal(int index, Task& task) {
+    const size_t count = workers_.size();
+    for (size_t i = 1; i < count; ++i) {
+      Worker& victim = *workers_[(static_cast<size_t>(index) + i) % count];
+      if (victim.deque.Steal(task)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool AnyStealable() const {
+    for (const auto& worker : workers_) {
+      if (!worker->deque.Empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Wake(Worker& worker) {
+    if (worker.state.load(std::memory_order_seq_cst) == kParked &&
+        worker.state.exchange(kRunning, std::memory_order_seq_cst) ==
+            kParked) {
+      FutexWake(worker.state);
+    }
+  }
+
+  void WakeOneParked() {
+    for (auto& worker : workers_) {
+      if (worker->state.load(std::memory_order_seq_cst) == kParked &&
+          worker->state.exchange(kRunning, std::memory_order_seq_cst) ==
+              kParked) {
+        FutexWake(worker->state);
+        return;
+      }
+    }
+  }
+
+  static void FutexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+            expected, nullptr, nullptr, 0);
+  }
+
+  static void FutexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+            1, nullptr, nullptr, 0);
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  alignas(64) std::atomic<size_t> next_worker_;  // 轮询投递位置
+  std::atomic<bool> stop_;
+};
+
+}  // namespace tinywebserver
+
+#endif  // TINYWEBSERVER_THREADPOOL_WORK_STEALING_H_
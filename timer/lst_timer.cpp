@@ -5,8 +5,10 @@
 
 #include <errno.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <limits>
 
 namespace tinywebserver {
 
@@ -118,6 +120,9 @@ void SortedTimerList::Tick() {
     if (current->callback_) {
       current->callback_(current->user_data_);
     }
+    if (current->user_data_) {
+      current->user_data_->timer = nullptr;
+    }
 
     head_ = current->next_;
     if (head_) {
@@ -152,10 +157,264 @@ void SortedTimerList::AddTimer(Timer* timer, Timer* list_head) {
   }
 }
 
+// TimingWheel 实现
+
+TimingWheel::TimingWheel(size_t slot_count, Duration tick)
+    : fine_count_(64),
+      mask_(0),
+      shift_(6),
+      tick_(tick),
+      origin_(std::chrono::steady_clock::now()),
+      current_tick_(0),
+      size_(0) {
+  // 至少 64 个细槽，位图中细槽与粗槽不共用同一个字
+  while (fine_count_ < slot_count) {
+    fine_count_ <<= 1;
+    ++shift_;
+  }
+  mask_ = fine_count_ - 1;
+  slots_.assign(fine_count_ + kCoarseSlots, nullptr);
+  occupied_.assign(slots_.size() / 64, 0);
+}
+
+uint64_t TimingWheel::ExpireTick(TimePoint time) const {
+  if (time <= origin_) {
+    return 0;
+  }
+  auto elapsed = (time - origin_).count();
+  auto tick = tick_.count();
+  return static_cast<uint64_t>((elapsed + tick - 1) / tick);
+}
+
+void TimingWheel::Link(Timer* timer) {
+  // 已经过期的定时器放到下一个刻度，由下一次 Tick 处理
+  if (timer->expire_tick_ <= current_tick_) {
+    timer->expire_tick_ = current_tick_ + 1;
+  }
+
+  // 一圈之内的定时器放入细槽，(current_tick_, current_tick_ + 一圈] 中的
+  // 刻度各占一个细槽；更远的按所在圈放入粗槽，超过 64 圈的放在最后一个粗槽
+  if (timer->expire_tick_ - current_tick_ <= fine_count_) {
+    timer->slot_ = timer->expire_tick_ & mask_;
+  } else {
+    uint64_t base = (current_tick_ + 1) >> shift_;
+    uint64_t rounds = std::min<uint64_t>(
+        (timer->expire_tick_ >> shift_) - base, kCoarseSlots);
+    timer->slot_ = fine_count_ + ((base + rounds) & (kCoarseSlots - 1));
+  }
+
+  Timer*& head = slots_[timer->slot_];
+  timer->prev_ = nullptr;
+  timer->next_ = head;
+  if (head) {
+    head->prev_ = timer;
+  }
+  head = timer;
+  occupied_[timer->slot_ / 64] |= uint64_t{1} << (timer->slot_ % 64);
+  timer->linked_ = true;
+}
+
+void TimingWheel::Unlink(Timer* timer) {
+  if (timer->prev_) {
+    timer->prev_->next_ = timer->next_;
+  } else {
+    slots_[timer->slot_] = timer->next_;
+    if (timer->next_ == nullptr) {
+      occupied_[timer->slot_ / 64] &= ~(uint64_t{1} << (timer->slot_ % 64));
+    }
+  }
+  if (timer->next_) {
+    timer->next_->prev_ = timer->prev_;
+  }
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+  timer->linked_ = false;
+}
+
+void TimingWheel::Cascade(uint64_t round) {
+  size_t slot = fine_count_ + (round & (kCoarseSlots - 1));
+  // 先摘下整条链表，超过 64 圈的定时器可能重新放回同一个粗槽
+  Timer* current = slots_[slot];
+  slots_[slot] = nullptr;
+  occupied_[slot / 64] &= ~(uint64_t{1} << (slot % 64));
+  while (current) {
+    Timer* next = current->next_;
+    Link(current);
+    current = next;
+  }
+}
+
+size_t TimingWheel::FindOccupied(size_t begin, size_t end) const {
+  while (begin < end) {
+    size_t word = begin / 64;
+    uint64_t bits = occupied_[word] & (~uint64_t{0} << (begin % 64));
+    if (bits) {
+      return std::min(word * 64 + static_cast<size_t>(__builtin_ctzll(bits)),
+                      end);
+    }
+    begin = (word + 1) * 64;
+  }
+  return end;
+}
+
+void TimingWheel::AddTimer(Timer* timer) {
+  if (!timer || timer->linked_) {
+    return;
+  }
+
+  timer->expire_tick_ = ExpireTick(timer->expire_time_);
+  Link(timer);
+  ++size_;
+}
+
+void TimingWheel::AdjustTimer(Timer* timer) {
+  if (!timer || !timer->linked_) {
+    return;
+  }
+
+  // 同一刻度内的调整无需移动
+  uint64_t expire_tick = ExpireTick(timer->expire_time_);
+  if (expire_tick == timer->expire_tick_) {
+    return;
+  }
+  Unlink(timer);
+  timer->expire_tick_ = expire_tick;
+  Link(timer);
+}
+
+void TimingWheel::DeleteTimer(Timer* timer) {
+  if (!timer || !timer->linked_) {
+    return;
+  }
+
+  Unlink(timer);
+  --size_;
+}
+
+bool TimingWheel::NextExpiry(TimePoint* when) const {
+  if (size_ == 0) {
+    return false;
+  }
+
+  // 细槽中每个槽只有一个刻度：从下一个刻度起按环形顺序找第一个非空槽
+  uint64_t next = current_tick_ + 1;
+  uint64_t round = next >> shift_;
+  uint64_t earliest = std::numeric_limits<uint64_t>::max();
+  size_t from = next & mask_;
+  size_t slot = FindOccupied(from, fine_count_);
+  if (slot < fine_count_) {
+    earliest = (round << shift_) | slot;
+  } else if ((slot = FindOccupied(0, from)) < from) {
+    earliest = ((round + 1) << shift_) | slot;
+  }
+
+  // 粗槽在其所在圈开始时级联，取最近一次级联的时刻，不必遍历链表
+  for (uint64_t i = 0; i < kCoarseSlots; ++i) {
+    slot = fine_count_ + ((round + i) & (kCoarseSlots - 1));
+    if ((occupied_[slot / 64] & (uint64_t{1} << (slot % 64))) == 0) {
+      continue;
+    }
+    // 本圈已经开始时，本圈的粗槽已级联过，其中只剩 64 圈之后的定时器
+    uint64_t cascade = i == 0 && (next & mask_) != 0 ? round + kCoarseSlots
+                                                     : round + i;
+    earliest = std::min(earliest, cascade << shift_);
+    if (i > 0) {
+      break;
+    }
+  }
+  *when = origin_ + tick_ * static_cast<int64_t>(earliest);
+  return true;
+}
+
+void TimingWheel::Tick(TimePoint now) {
+  if (now < origin_) {
+    return;
+  }
+  uint64_t target = static_cast<uint64_t>((now - origin_) / tick_);
+
+  while (current_tick_ < target) {
+    uint64_t next = current_tick_ + 1;
+    if ((next & mask_) == 0) {
+      // 进入新的一圈，把这一圈的粗槽定时器放入细槽
+      Cascade(next >> shift_);
+    }
+
+    // 在本圈剩余的刻度中找第一个非空细槽，空槽直接跳过
+    uint64_t last = std::min(target, next | mask_);
+    size_t slot = FindOccupied(next & mask_, (last & mask_) + 1);
+    if (slot > (last & mask_)) {
+      current_tick_ = last;
+      continue;
+    }
+    current_tick_ = (next & ~mask_) | slot;
+
+    Timer* current = slots_[slot];
+    while (current) {
+      Timer* next_timer = current->next_;
+      // 回调中新加入的定时器可能落在同一细槽的下一圈，按刻度区分
+      if (current->expire_tick_ == current_tick_) {
+        // 先摘下定时器再回调，回调关闭 fd 后该槽位可能立即被复用
+        Unlink(current);
+        --size_;
+        if (current->user_data_) {
+          current->user_data_->timer = nullptr;
+        }
+        if (current->callback_) {
+          current->callback_(current->user_data_);
+        }
+      }
+      current = next_timer;
+    }
+  }
+}
+
 // TimerUtils 实现
 
-void TimerUtils::Init(int timeslot) {
-  timeslot_ = timeslot;
+TimerUtils::TimerUtils()
+    : timer_fd_(-1), armed_deadline_(Timer::TimePoint::max()) {}
+
+TimerUtils::~TimerUtils() {
+  if (timer_fd_ != -1) {
+    close(timer_fd_);
+  }
+}
+
+bool TimerUtils::InitTimerFd(int epollfd) {
+  // steady_clock 即 CLOCK_MONOTONIC，可以直接用绝对时间设置 timerfd
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd_ == -1) {
+    return false;
+  }
+  AddFd(epollfd, timer_fd_, false, 0);
+  return true;
+}
+
+void TimerUtils::ArmBefore(Timer::TimePoint deadline) {
+  if (deadline < armed_deadline_) {
+    Rearm();
+  }
+}
+
+void TimerUtils::Rearm() {
+  Timer::TimePoint next = Timer::TimePoint::max();
+  timer_wheel_.NextExpiry(&next);
+  if (next == armed_deadline_) {
+    return;
+  }
+  armed_deadline_ = next;
+
+  // it_value 全零表示解除定时
+  itimerspec spec;
+  std::memset(&spec, 0, sizeof(spec));
+  if (next != Timer::TimePoint::max()) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  next.time_since_epoch())
+                  .count();
+    ns = std::max<decltype(ns)>(ns, 1);
+    spec.it_value.tv_sec = ns / 1000000000;
+    spec.it_value.tv_nsec = ns % 1000000000;
+  }
+  timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
 }
 
 int TimerUtils::SetNonBlocking(int fd) {
@@ -183,22 +442,6 @@ void TimerUtils::AddFd(int epollfd, int fd, bool one_shot, int trigger_mode) {
   SetNonBlocking(fd);
 }
 
-void TimerUtils::SignalHandler(int sig) {
-  // 立即输出，不管其他
-  const char* msg_str = "[SIGNAL HANDLER CALLED]\n";
-  write(STDERR_FILENO, msg_str, strlen(msg_str));
-  
-  // 保存 errno 以保证可重入性
-  int saved_errno = errno;
-  int msg = sig;
-  
-  if (pipe_fd_ != nullptr && pipe_fd_[1] >= 0) {
-    send(pipe_fd_[1], reinterpret_cast<char*>(&msg), 1, 0);
-  }
-  
-  errno = saved_errno;
-}
-
 void TimerUtils::AddSignal(int sig, void (*handler)(int), bool restart) {
   struct sigaction sa;
   std::memset(&sa, 0, sizeof(sa));
@@ -210,17 +453,19 @@ void TimerUtils::AddSignal(int sig, void (*handler)(int), bool restart) {
 
   sigfillset(&sa.sa_mask);
   int ret = sigaction(sig, &sa, nullptr);
-  
-  fprintf(stderr, "[AddSignal] Registering signal %d, handler=%p, result=%d\n", 
-          sig, (void*)handler, ret);
-  fflush(stderr);
-  
   assert(ret != -1);
+  (void)ret;
 }
 
 void TimerUtils::HandleTimer() {
-  timer_list_.Tick();
-  alarm(timeslot_);
+  // 读出到期次数以清除可读状态；timerfd 是一次性的，触发后即处于解除状态
+  uint64_t expirations = 0;
+  ssize_t n = read(timer_fd_, &expirations, sizeof(expirations));
+  (void)n;
+  armed_deadline_ = Timer::TimePoint::max();
+
+  timer_wheel_.Tick();
+  Rearm();
 }
 
 void TimerUtils::ShowError(int connfd, const char* info) {
@@ -228,17 +473,20 @@ void TimerUtils::ShowError(int connfd, const char* info) {
   close(connfd);
 }
 
-// 静态成员初始化
-int* TimerUtils::pipe_fd_ = nullptr;
-int TimerUtils::epoll_fd_ = 0;
-
 // 定时器回调函数
 void TimerCallback(ClientData* user_data) {
   if (!user_data) {
     return;
   }
 
-  epoll_ctl(TimerUtils::epoll_fd_, EPOLL_CTL_DEL, user_data->sockfd, nullptr);
+  // 工作线程仍持有该连接，等完成通知全部返回后再关闭
+  if (user_data->pending_tasks > 0) {
+    user_data->close_pending = true;
+    return;
+  }
+  user_data->close_pending = false;
+
+  epoll_ctl(user_data->epollfd, EPOLL_CTL_DEL, user_data->sockfd, nullptr);
   close(user_data->sockfd);
   
   // 减少用户计数（将在链接时与 http_conn 模块正确链接）
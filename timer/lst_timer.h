@@ -1,5 +1,6 @@
 // Copyright 2025 TinyWebServer
-// Timer management with sorted linked list for connection timeout handling
+// Timer management (sorted list and hashed timing wheel) for connection
+// timeout handling
 // Follows Google C++ Style Guide
 
 #ifndef TINYWEBSERVER_TIMER_LST_TIMER_H_
@@ -11,12 +12,15 @@
 #include <signal.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
 #include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "../log/log.h"
 
@@ -26,14 +30,21 @@ namespace tinywebserver {
 class Timer;
 class HttpConnection;
 
-// Client connection data associated with a timer
+// Client connection data associated with a timer.
+// Trivially default-constructible so the server's connection table can live
+// in zero-filled anonymous memory without constructing its slots; all zero
+// (no timer, no pending tasks) is the state of an unused fd, and every
+// field is set when a connection is accepted.
 struct ClientData {
   sockaddr_in address;
-  int sockfd{-1};
-  Timer* timer{nullptr};
+  int sockfd;
+  int epollfd;          // Epoll instance of the sub-reactor owning the socket
+  Timer* timer;
+  int pending_tasks;    // Worker tasks whose completion is not drained
+  bool close_pending;   // Close deferred until pending_tasks drops to 0
 };
 
-// Timer node in the sorted timer list.
+// Timer node shared by SortedTimerList and TimingWheel.
 // Manages timeout for a single connection.
 class Timer {
  public:
@@ -45,7 +56,10 @@ class Timer {
         callback_(nullptr),
         user_data_(nullptr),
         prev_(nullptr),
-        next_(nullptr) {}
+        next_(nullptr),
+        expire_tick_(0),
+        slot_(0),
+        linked_(false) {}
 
   ~Timer() = default;
 
@@ -60,6 +74,9 @@ class Timer {
   ClientData* user_data_;  // Associated client data
   Timer* prev_;            // Previous timer in list
   Timer* next_;            // Next timer in list
+  uint64_t expire_tick_;   // Wheel tick at which the timer fires
+  size_t slot_;            // TimingWheel slot the timer is linked into
+  bool linked_;            // Whether the timer is in a TimingWheel slot
 };
 
 // Sorted timer list for managing connection timeouts.
@@ -99,19 +116,117 @@ class SortedTimerList {
   Timer* tail_;  // Tail of the timer list
 };
 
-// Utility class for managing epoll, signals, and timers
+// Two-level timing wheel with O(1) add, adjust and delete.
+// Time is quantized into ticks. A timer due within one revolution
+// (slot_count ticks) lives in the fine slot t % slot_count, so every fine
+// slot holds timers of a single tick. Timers further out wait in one of 64
+// coarse slots, each covering a revolution, and are cascaded into the fine
+// slots when the wheel enters their revolution; timers beyond 64
+// revolutions wait in the last coarse slot and are cascaded again.
+// An occupancy bitmap lets Tick and NextExpiry skip empty slots with
+// find-first-set instead of probing every slot.
+// The wheel does not own its timers: callers keep them in a slab (the
+// server indexes one per fd) and the wheel only links them into slots.
+class TimingWheel {
+ public:
+  using TimePoint = Timer::TimePoint;
+  using Duration = std::chrono::steady_clock::duration;
+
+  // @param slot_count Number of fine slots, rounded up to a power of two
+  //                   (at least 64)
+  // @param tick Time covered by one slot
+  explicit TimingWheel(size_t slot_count = 16384,
+                       Duration tick = std::chrono::milliseconds(1));
+  ~TimingWheel() = default;
+
+  // Disable copy and move operations
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel& operator=(const TimingWheel&) = delete;
+  TimingWheel(TimingWheel&&) = delete;
+  TimingWheel& operator=(TimingWheel&&) = delete;
+
+  // Links a timer into the slot of its expire_time_.
+  // @param timer Timer to add (must not be null or already linked)
+  void AddTimer(Timer* timer);
+
+  // Moves a timer to the slot of its updated expire_time_.
+  // @param timer Timer to adjust
+  void AdjustTimer(Timer* timer);
+
+  // Unlinks a timer. The timer itself is not freed.
+  // @param timer Timer to delete
+  void DeleteTimer(Timer* timer);
+
+  // Fires every timer whose tick has been reached by now. Each expired
+  // timer is unlinked and detached from its ClientData before its
+  // callback runs, so the callback may close (and thus recycle) the fd.
+  // @param now Current time
+  void Tick(TimePoint now = std::chrono::steady_clock::now());
+
+  // Finds the earliest time at which Tick would fire a timer, or cascade
+  // a coarse slot if that comes first. O(slot_count / 64) bitmap words.
+  // @param when Output parameter, start of the earliest due tick
+  // @return false if no timer is linked
+  bool NextExpiry(TimePoint* when) const;
+
+  // @return Number of linked timers
+  size_t size() const { return size_; }
+
+ private:
+  static constexpr size_t kCoarseSlots = 64;
+
+  // Converts a time point to a tick, rounding up so timers never fire early
+  uint64_t ExpireTick(TimePoint time) const;
+
+  // Links a timer into the fine or coarse slot for its expire_tick_
+  void Link(Timer* timer);
+  void Unlink(Timer* timer);
+
+  // Relinks the timers of the coarse slot for revolution `round`
+  void Cascade(uint64_t round);
+
+  // @return First occupied slot in [begin, end), or end if there is none
+  size_t FindOccupied(size_t begin, size_t end) const;
+
+  // Fine slots [0, slot_count) followed by kCoarseSlots coarse slots;
+  // head of each slot's doubly linked list
+  std::vector<Timer*> slots_;
+  std::vector<uint64_t> occupied_;  // One bit per slot, set if non-empty
+  size_t fine_count_;          // Number of fine slots (a power of two)
+  size_t mask_;                // fine_count_ - 1
+  int shift_;                  // log2(fine_count_), ticks per revolution
+  Duration tick_;              // Time covered by one slot
+  TimePoint origin_;           // Time of tick 0
+  uint64_t current_tick_;      // Last tick processed
+  size_t size_;                // Number of linked timers
+};
+
+// Utility class for managing epoll, signals, and timers.
+// Connection timers live in a TimingWheel driven by a timerfd that is
+// always armed to the wheel's nearest deadline, so the event loop can block
+// in epoll_wait indefinitely and timeouts have millisecond resolution.
 class TimerUtils {
  public:
-  TimerUtils() : timeslot_(0) {}
-  ~TimerUtils() = default;
+  TimerUtils();
+  ~TimerUtils();
 
   // Disable copy operations
   TimerUtils(const TimerUtils&) = delete;
   TimerUtils& operator=(const TimerUtils&) = delete;
 
-  // Initializes the timer utilities with a timeslot duration.
-  // @param timeslot Time interval in seconds for alarm signals
-  void Init(int timeslot);
+  // Creates the timerfd driving the timer wheel and adds it to epoll.
+  // @param epollfd Epoll file descriptor
+  // @return true if successful, false otherwise
+  bool InitTimerFd(int epollfd);
+
+  // @return timerfd to match against epoll events
+  int timer_fd() const { return timer_fd_; }
+
+  // Makes sure the timerfd fires no later than the given deadline.
+  // Call after adding a timer; adjusted timers only move later, so an
+  // early expiration is harmless and just re-arms for the real deadline.
+  // @param deadline Expiration time of the new timer
+  void ArmBefore(Timer::TimePoint deadline);
 
   // Sets a file descriptor to non-blocking mode.
   // @param fd File descriptor to modify
@@ -125,17 +240,14 @@ class TimerUtils {
   // @param trigger_mode 0=LT, 1=ET
   void AddFd(int epollfd, int fd, bool one_shot, int trigger_mode);
 
-  // Signal handler function.
-  // @param sig Signal number
-  static void SignalHandler(int sig);
-
   // Registers a signal handler.
   // @param sig Signal number
   // @param handler Handler function
   // @param restart Whether to restart interrupted system calls
   void AddSignal(int sig, void (*handler)(int), bool restart = true);
 
-  // Handles timer expiration and reschedules alarm.
+  // Handles a timerfd expiration: fires expired timers and re-arms the
+  // timerfd for the next deadline.
   void HandleTimer();
 
   // Sends error message to client and closes connection.
@@ -143,16 +255,20 @@ class TimerUtils {
   // @param info Error message
   void ShowError(int connfd, const char* info);
 
-  // Static members for signal handling
-  static int* pipe_fd_;       // Pipe for signal notification
-  static int epoll_fd_;       // Epoll file descriptor
+  TimingWheel timer_wheel_;  // Connection timers
+
+ private:
+  // Arms the timerfd for the wheel's nearest deadline, or disarms it.
+  void Rearm();
 
-  SortedTimerList timer_list_;  // Timer list
-  int timeslot_;                // Timer interval in seconds
+  int timer_fd_;                     // timerfd driving timer_wheel_
+  Timer::TimePoint armed_deadline_;  // Current timerfd deadline, max() if none
 };
 
 // Callback function for timer expiration.
-// Closes the connection and decrements the user count.
+// Closes the connection and decrements the user count. If a worker thread
+// still holds the connection, the close is deferred (close_pending) so the
+// fd cannot be reused while the worker is running.
 // @param user_data Client data associated with the timer
 void TimerCallback(ClientData* user_data);
 
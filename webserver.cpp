@@ -8,11 +8,17 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 
 #include <cassert>
 #include <cstring>
 #include <filesystem>
+#include <stdexcept>
+
+#include "./http/mime_types.h"
 
 namespace tinywebserver {
 
@@ -22,9 +28,10 @@ WebServer::WebServer()
       log_write_mode_(0),
       close_log_(0),
       actor_model_(0),
-      pipe_fd_{-1, -1},
-      epoll_fd_(-1),
-      users_(kMaxFd),
+      reactor_num_(1),
+      signal_fd_(-1),
+      stop_fd_(-1),
+      slots_(nullptr),
       conn_pool_(nullptr),
       db_user_(),
       db_password_(),
@@ -32,40 +39,73 @@ WebServer::WebServer()
       sql_connection_num_(0),
       thread_pool_(nullptr),
       thread_num_(0),
-      listen_fd_(-1),
+      work_stealing_(0),
+      stop_server_(false),
       opt_linger_(0),
       trigger_mode_(0),
       listen_trigger_mode_(0),
-      conn_trigger_mode_(0),
-      users_timer_(kMaxFd) {
+      conn_trigger_mode_(0) {
   // 设置根目录路径
   root_dir_ = (std::filesystem::current_path() / "root").string();
+
+  // 连接表用匿名映射分配：页按需清零提交，只有用到的 fd 所在的页占用内存
+  void* slots = mmap(nullptr, kMaxFd * sizeof(ConnectionSlot),
+                     PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (slots == MAP_FAILED) {
+    throw std::runtime_error("WebServer: connection table mmap failed");
+  }
+  // 全零即空闲槽位，ConnectionSlot 无需逐个构造
+  slots_ = static_cast<ConnectionSlot*>(slots);
 }
 
 WebServer::~WebServer() {
-  if (epoll_fd_ != -1) {
-    close(epoll_fd_);
-    epoll_fd_ = -1;
+  // 先停止工作线程，它们会向子反应堆的完成队列投递结果
+  thread_pool_.reset();
+  // 用户表的刷新线程使用连接池，须在连接池析构前停止
+  UserStore::GetInstance()->StopRefresh();
+
+  for (auto& reactor : reactors_) {
+    if (reactor->thread.joinable()) {
+      reactor->thread.join();
+    }
+    if (reactor->epoll_fd != -1) {
+      close(reactor->epoll_fd);
+      reactor->epoll_fd = -1;
+    }
+    if (reactor->listen_fd != -1) {
+      close(reactor->listen_fd);
+      reactor->listen_fd = -1;
+    }
   }
-  if (listen_fd_ != -1) {
-    close(listen_fd_);
-    listen_fd_ = -1;
+  if (stop_fd_ != -1) {
+    close(stop_fd_);
+    stop_fd_ = -1;
   }
-  if (pipe_fd_[1] != -1) {
-    close(pipe_fd_[1]);
-    pipe_fd_[1] = -1;
+  if (signal_fd_ != -1) {
+    close(signal_fd_);
+    signal_fd_ = -1;
   }
-  if (pipe_fd_[0] != -1) {
-    close(pipe_fd_[0]);
-    pipe_fd_[0] = -1;
+
+  // 释放仍打开的连接，空闲池随子反应堆一起释放；
+  // 只遍历各子反应堆的连接链表，不触碰整张连接表
+  for (auto& reactor : reactors_) {
+    Connection* conn = reactor->live_connections;
+    while (conn) {
+      Connection* next = conn->live_next;
+      delete conn;
+      conn = next;
+    }
+    reactor->live_connections = nullptr;
   }
+  munmap(slots_, kMaxFd * sizeof(ConnectionSlot));
 }
 
 void WebServer::Init(int port, const std::string& user,
                      const std::string& password,
                      const std::string& database_name, int log_write_mode,
                      int opt_linger, int trigger_mode, int sql_num,
-                     int thread_num, int close_log, int actor_model) {
+                     int thread_num, int close_log, int actor_model,
+                     int reactor_num, int work_stealing) {
   port_ = port;
   db_user_ = user;
   db_password_ = password;
@@ -77,6 +117,15 @@ void WebServer::Init(int port, const std::string& user,
   trigger_mode_ = trigger_mode;
   close_log_ = close_log;
   actor_model_ = actor_model;
+  reactor_num_ = reactor_num > 0 ? reactor_num : 1;
+  work_stealing_ = work_stealing;
+
+  // 在创建日志/工作线程之前屏蔽 SIGTERM，之后创建的线程都会继承该屏蔽字，
+  // SIGTERM 只能通过主反应堆的 signalfd 被读取
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &mask, nullptr);
 }
 
 void WebServer::SetTriggerMode() {
@@ -102,323 +151,468 @@ void WebServer::SetTriggerMode() {
   }
 }
 
-void WebServer::InitLog() {
+void WebServer::InitLog(int level, int binary) {
   if (close_log_ == 0) {
     // 初始化日志系统
+    auto log_level = static_cast<LogLevel>(level);
     if (log_write_mode_ == 1) {
-      Logger::GetInstance()->Init("./ServerLog", close_log_, 2000, 800000, 800);
+      Logger::GetInstance()->Init("./ServerLog", close_log_, 2000, 800000, 800,
+                                  log_level, binary != 0);
     } else {
-      Logger::GetInstance()->Init("./ServerLog", close_log_, 2000, 800000, 0);
+      Logger::GetInstance()->Init("./ServerLog", close_log_, 2000, 800000, 0,
+                                  log_level, binary != 0);
     }
   }
 }
 
+void WebServer::InitAccessLog(int format, int sample_rate) {
+  if (format != 0) {
+    // 访问日志独立于普通日志，close_log 不影响它
+    AccessLog::GetInstance()->Init(
+        "./AccessLog", static_cast<AccessLog::Format>(format), sample_rate);
+  }
+}
+
 void WebServer::InitSqlPool() {
   // 初始化数据库连接池
   conn_pool_ = ConnectionPool::GetInstance();
   conn_pool_->Init("localhost", db_user_, db_password_, db_name_, 3306,
                    sql_connection_num_, close_log_);
 
-  // 初始化数据库用户表
-  if (!users_.empty()) {
-    users_.front().initmysql_result(conn_pool_);
+}
+
+void WebServer::InitUserStore(int refresh_s) {
+  // 启动时加载一次用户表，之后由后台线程定期刷新
+  UserStore* store = UserStore::GetInstance();
+  store->Refresh(conn_pool_);
+  store->StartRefresh(conn_pool_, refresh_s);
+  LOG_INFO("User store: %zu users, refresh every %d s", store->size(),
+           refresh_s);
+}
+
+void WebServer::InitFileCache(int memory_mb, int max_entry_kb,
+                              int revalidate_ms, int sendfile_threshold_kb) {
+  FileCache::GetInstance()->Init(static_cast<size_t>(memory_mb) << 20,
+                                 static_cast<size_t>(max_entry_kb) << 10,
+                                 revalidate_ms,
+                                 static_cast<size_t>(sendfile_threshold_kb) << 10);
+  LOG_INFO("File cache: %d MB budget, %d KB max entry, %d ms revalidate, "
+           "sendfile from %d KB",
+           memory_mb, max_entry_kb, revalidate_ms, sendfile_threshold_kb);
+}
+
+void WebServer::InitCacheControl(
+    const std::vector<std::pair<std::string, std::string>>& rules) {
+  HttpConnection::SetCacheControlRules(rules);
+  LOG_INFO("Cache-Control rules: %zu", rules.size());
+}
+
+void WebServer::InitCompression(int mode) {
+  HttpConnection::SetCompression(mode);
+  LOG_INFO("Compression mode: %d (gzip %s, brotli %s)", mode,
+           CanCompress(ContentEncoding::kGzip) ? "on" : "off",
+           CanCompress(ContentEncoding::kBrotli) ? "on" : "off");
+}
+
+void WebServer::InitMimeTypes(const std::string& file) {
+  if (file.empty()) {
+    return;
+  }
+  int count = LoadMimeTypes(file);
+  if (count < 0) {
+    LOG_ERROR("Failed to open MIME types file %s", file.c_str());
+  } else {
+    LOG_INFO("Loaded %d MIME types from %s", count, file.c_str());
   }
 }
 
 void WebServer::InitThreadPool() {
   // 初始化线程池
   LOG_INFO("Starting thread pool initialization...");
-  thread_pool_ =
-      std::make_unique<ThreadPool<HttpConnection>>(actor_model_, conn_pool_, thread_num_);
+  thread_pool_ = std::make_unique<ThreadPool<HttpConnection>>(
+      actor_model_, thread_num_, 10000, work_stealing_ == 1);
   LOG_INFO("Thread pool initialized successfully!");
 }
 
 void WebServer::StartListen() {
-  // 创建监听套接字
-  listen_fd_ = socket(PF_INET, SOCK_STREAM, 0);
-  assert(listen_fd_ >= 0);
-
-  // 配置 SO_LINGER 选项
-  if (opt_linger_ == 0) {
-    struct linger tmp = {0, 1};
-    setsockopt(listen_fd_, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
-  } else if (opt_linger_ == 1) {
-    struct linger tmp = {1, 1};
-    setsockopt(listen_fd_, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
-  }
+  // 多个子反应堆共享同一端口，由内核通过 SO_REUSEPORT 做负载均衡
+  const bool reuse_port = reactor_num_ > 1;
+
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  assert(stop_fd_ != -1);
+
+  reactors_.reserve(static_cast<size_t>(reactor_num_));
+  for (int i = 0; i < reactor_num_; ++i) {
+    auto reactor = std::make_unique<SubReactor>();
+    reactor->id = i;
+    reactor->events.resize(kMaxEventNumber);
+
+    // 创建监听套接字
+    reactor->listen_fd = socket(PF_INET, SOCK_STREAM, 0);
+    assert(reactor->listen_fd >= 0);
+
+    // 配置 SO_LINGER 选项
+    if (opt_linger_ == 0) {
+      struct linger tmp = {0, 1};
+      setsockopt(reactor->listen_fd, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
+    } else if (opt_linger_ == 1) {
+      struct linger tmp = {1, 1};
+      setsockopt(reactor->listen_fd, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
+    }
 
-  // 绑定套接字
-  int ret = 0;
-  struct sockaddr_in address;
-  std::memset(&address, 0, sizeof(address));
-  address.sin_family = AF_INET;
-  address.sin_addr.s_addr = htonl(INADDR_ANY);
-  address.sin_port = htons(port_);
-
-  int flag = 1;
-  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
-  ret = bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address),
-             sizeof(address));
-  assert(ret >= 0);
-  ret = listen(listen_fd_, 5);
-  assert(ret >= 0);
-
-  timer_utils_.Init(kTimeSlot);
-
-  // 创建 epoll 实例
-  epoll_fd_ = epoll_create(5);
-  assert(epoll_fd_ != -1);
-
-  timer_utils_.AddFd(epoll_fd_, listen_fd_, false, listen_trigger_mode_);
-  HttpConnection::m_epollfd = epoll_fd_;
-
-  // 创建信号管道
-  ret = socketpair(PF_UNIX, SOCK_STREAM, 0, pipe_fd_);
-  assert(ret != -1);
-  timer_utils_.SetNonBlocking(pipe_fd_[1]);
-  timer_utils_.AddFd(epoll_fd_, pipe_fd_[0], false, 0);
-
-  // 设置用于信号处理的静态成员（必须在注册信号处理器之前）
-  TimerUtils::pipe_fd_ = pipe_fd_;
-  TimerUtils::epoll_fd_ = epoll_fd_;
-
-  // 注册信号处理器
-  timer_utils_.AddSignal(SIGPIPE, SIG_IGN);
-  timer_utils_.AddSignal(SIGALRM, TimerUtils::SignalHandler, false);
-  timer_utils_.AddSignal(SIGTERM, TimerUtils::SignalHandler, false);
-
-  alarm(kTimeSlot);
-}
+    // 绑定套接字
+    int ret = 0;
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port_);
+
+    int flag = 1;
+    setsockopt(reactor->listen_fd, SOL_SOCKET, SO_REUSEADDR, &flag,
+               sizeof(flag));
+    if (reuse_port) {
+      setsockopt(reactor->listen_fd, SOL_SOCKET, SO_REUSEPORT, &flag,
+                 sizeof(flag));
+    }
+    ret = bind(reactor->listen_fd, reinterpret_cast<struct sockaddr*>(&address),
+               sizeof(address));
+    assert(ret >= 0);
+    ret = listen(reactor->listen_fd, 5);
+    assert(ret >= 0);
+
+    // 创建 epoll 实例
+    reactor->epoll_fd = epoll_create(5);
+    assert(reactor->epoll_fd != -1);
+
+    // 每个子反应堆用自己的 timerfd 驱动时间轮
+    bool timer_ok = reactor->timer_utils.InitTimerFd(reactor->epoll_fd);
+    assert(timer_ok);
+    (void)timer_ok;
+
+    reactor->timer_utils.AddFd(reactor->epoll_fd, reactor->listen_fd, false,
+                               listen_trigger_mode_);
+    reactor->timer_utils.AddFd(reactor->epoll_fd, stop_fd_, false, 0);
+
+    // 工作线程通过完成队列把关闭/定时器调整请求交回本反应堆
+    reactor->completions = std::make_unique<CompletionQueue>(kMaxFd);
+    reactor->timer_utils.AddFd(reactor->epoll_fd, reactor->completions->fd(),
+                               false, 0);
+
+    reactors_.push_back(std::move(reactor));
+  }
 
-void WebServer::AddTimer(int connfd, const sockaddr_in& client_address) {
-  users_[connfd].init(connfd, client_address,
-                      const_cast<char*>(root_dir_.c_str()), conn_trigger_mode_,
-                      close_log_, db_user_, db_password_, db_name_);
+  // SIGTERM 已在 Init 中屏蔽，通过 signalfd 只注册到主反应堆
+  SubReactor& main_reactor = *reactors_.front();
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGTERM);
+  signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  assert(signal_fd_ != -1);
+  main_reactor.timer_utils.AddFd(main_reactor.epoll_fd, signal_fd_, false, 0);
 
-  // 初始化客户端数据并创建定时器
-  users_timer_[connfd].address = client_address;
-  users_timer_[connfd].sockfd = connfd;
+  main_reactor.timer_utils.AddSignal(SIGPIPE, SIG_IGN);
+}
 
-  Timer* timer = new Timer;
-  timer->user_data_ = &users_timer_[connfd];
-  timer->callback_ = TimerCallback;
+void WebServer::AddTimer(SubReactor& reactor, int connfd,
+                         const sockaddr_in& client_address) {
+  // 优先复用本反应堆关闭过的连接对象，池空时才分配
+  std::unique_ptr<Connection> conn;
+  if (!reactor.idle_connections.empty()) {
+    conn = std::move(reactor.idle_connections.back());
+    reactor.idle_connections.pop_back();
+  } else {
+    conn = std::make_unique<Connection>();
+    // 连接对象不会离开创建它的反应堆，回调只需设置一次
+    conn->timer.callback_ = [this, &reactor](ClientData* data) {
+      CloseConnection(reactor, data->sockfd);
+    };
+  }
+  conn->http.init(connfd, client_address, reactor.epoll_fd,
+                  reactor.completions.get(),
+                  const_cast<char*>(root_dir_.c_str()), conn_trigger_mode_);
+
+  // 初始化客户端数据并启用连接的定时器
+  ConnectionSlot& slot = slots_[connfd];
+  slot.client.address = client_address;
+  slot.client.sockfd = connfd;
+  slot.client.epollfd = reactor.epoll_fd;
+  slot.client.pending_tasks = 0;
+  slot.client.close_pending = false;
+  slot.accepted_batch = reactor.batch;
+
+  Timer* timer = &conn->timer;
+  timer->user_data_ = &slot.client;
 
   auto now = std::chrono::steady_clock::now();
   timer->expire_time_ = now + std::chrono::seconds(3 * kTimeSlot);
 
-  users_timer_[connfd].timer = timer;
-  timer_utils_.timer_list_.AddTimer(timer);
+  slot.client.timer = timer;
+  slot.conn = conn.release();
+  slot.conn->live_prev = nullptr;
+  slot.conn->live_next = reactor.live_connections;
+  if (reactor.live_connections) {
+    reactor.live_connections->live_prev = slot.conn;
+  }
+  reactor.live_connections = slot.conn;
+  reactor.timer_utils.timer_wheel_.AddTimer(timer);
+  reactor.timer_utils.ArmBefore(timer->expire_time_);
 }
 
-void WebServer::AdjustTimer(Timer* timer) {
+void WebServer::AdjustTimer(SubReactor& reactor, Timer* timer) {
   auto now = std::chrono::steady_clock::now();
   timer->expire_time_ = now + std::chrono::seconds(3 * kTimeSlot);
-  timer_utils_.timer_list_.AdjustTimer(timer);
+  reactor.timer_utils.timer_wheel_.AdjustTimer(timer);
 
-  LOG_INFO("%s", "adjust timer once");
+  LOG_DEBUG("%s", "adjust timer once");
 }
 
-void WebServer::HandleTimer(Timer* timer, int sockfd) {
-  if (timer && timer->callback_) {
-    timer->callback_(&users_timer_[sockfd]);
-  }
-  if (timer) {
-    timer_utils_.timer_list_.DeleteTimer(timer);
+void WebServer::HandleTimer(SubReactor& reactor, int sockfd) {
+  // 先摘下定时器再关闭连接：fd 关闭后可能立即被其他子反应堆复用
+  ClientData& data = slots_[sockfd].client;
+  if (data.timer) {
+    reactor.timer_utils.timer_wheel_.DeleteTimer(data.timer);
+    data.timer = nullptr;
   }
+  LOG_DEBUG("close fd %d", sockfd);
+  CloseConnection(reactor, sockfd);
+}
 
-  LOG_INFO("close fd %d", users_timer_[sockfd].sockfd);
-  users_timer_[sockfd].timer = nullptr;
+void WebServer::CloseConnection(SubReactor& reactor, int sockfd) {
+  ConnectionSlot& slot = slots_[sockfd];
+  // 没有工作线程再持有该连接时才回收对象；回收只放入空闲池，
+  // 此时可能正在执行该连接定时器的回调，不能在这里析构
+  if (slot.client.pending_tasks == 0 && slot.conn) {
+    Connection* conn = slot.conn;
+    if (conn->live_prev) {
+      conn->live_prev->live_next = conn->live_next;
+    } else {
+      reactor.live_connections = conn->live_next;
+    }
+    if (conn->live_next) {
+      conn->live_next->live_prev = conn->live_prev;
+    }
+    reactor.idle_connections.emplace_back(conn);
+    slot.conn = nullptr;
+  }
+  TimerCallback(&slot.client);
 }
 
-bool WebServer::HandleClientData() {
+bool WebServer::HandleClientData(SubReactor& reactor) {
   struct sockaddr_in client_address;
   socklen_t client_addrlength = sizeof(client_address);
 
   if (listen_trigger_mode_ == 0) {
     // LT 模式
-    int connfd = accept(listen_fd_, reinterpret_cast<struct sockaddr*>(&client_address),
+    int connfd = accept(reactor.listen_fd,
+                        reinterpret_cast<struct sockaddr*>(&client_address),
                         &client_addrlength);
     if (connfd < 0) {
       LOG_ERROR("%s:errno is:%d", "accept error", errno);
       return false;
     }
     if (HttpConnection::m_user_count >= kMaxFd) {
-      timer_utils_.ShowError(connfd, "Internal server busy");
+      reactor.timer_utils.ShowError(connfd, "Internal server busy");
       LOG_ERROR("%s", "Internal server busy");
       return false;
     }
-    AddTimer(connfd, client_address);
+    AddTimer(reactor, connfd, client_address);
   } else {
     // ET 模式
     while (true) {
-      int connfd = accept(listen_fd_, reinterpret_cast<struct sockaddr*>(&client_address),
+      int connfd = accept(reactor.listen_fd,
+                          reinterpret_cast<struct sockaddr*>(&client_address),
                           &client_addrlength);
       if (connfd < 0) {
         LOG_ERROR("%s:errno is:%d", "accept error", errno);
         break;
       }
       if (HttpConnection::m_user_count >= kMaxFd) {
-        timer_utils_.ShowError(connfd, "Internal server busy");
+        reactor.timer_utils.ShowError(connfd, "Internal server busy");
         LOG_ERROR("%s", "Internal server busy");
         break;
       }
-      AddTimer(connfd, client_address);
+      AddTimer(reactor, connfd, client_address);
     }
     return false;
   }
   return true;
 }
 
-bool WebServer::HandleSignal(bool& timeout, bool& stop_server) {
-  int ret = 0;
-  int sig;
-  char signals[1024];
-  ret = recv(pipe_fd_[0], signals, sizeof(signals), 0);
-
-  if (ret == -1) {
-    return false;
-  } else if (ret == 0) {
+bool WebServer::HandleSignal(bool& stop_server) {
+  signalfd_siginfo info[8];
+  ssize_t ret = read(signal_fd_, info, sizeof(info));
+  if (ret <= 0) {
     return false;
-  } else {
-    for (int i = 0; i < ret; ++i) {
-      switch (signals[i]) {
-        case SIGALRM: {
-          timeout = true;
-          break;
-        }
-        case SIGTERM: {
-          stop_server = true;
-          break;
-        }
-      }
+  }
+
+  size_t count = static_cast<size_t>(ret) / sizeof(signalfd_siginfo);
+  for (size_t i = 0; i < count; ++i) {
+    if (info[i].ssi_signo == SIGTERM) {
+      stop_server = true;
     }
   }
   return true;
 }
 
-void WebServer::HandleRead(int sockfd) {
-  Timer* timer = users_timer_[sockfd].timer;
-
-  // Reactor 模型
-  if (actor_model_ == 1) {
-    if (timer) {
-      AdjustTimer(timer);
+void WebServer::HandleCompletions(SubReactor& reactor) {
+  reactor.completions->Drain([this, &reactor](const Completion& completion) {
+    int sockfd = completion.sockfd;
+    ClientData& data = slots_[sockfd].client;
+    --data.pending_tasks;
+    if (completion.type == CompletionType::kClose ||
+        (data.close_pending && data.pending_tasks == 0)) {
+      HandleTimer(reactor, sockfd);
+    } else if (data.timer) {
+      AdjustTimer(reactor, data.timer);
     }
+  });
+}
 
-    // 将读事件添加到请求队列
-    thread_pool_->Append(std::shared_ptr<HttpConnection>(&users_[sockfd], [](HttpConnection*){}), 0);
-
-    while (true) {
-      if (users_[sockfd].improv == 1) {
-        if (users_[sockfd].timer_flag == 1) {
-          HandleTimer(timer, sockfd);
-          users_[sockfd].timer_flag = 0;
-        }
-        users_[sockfd].improv = 0;
-        break;
-      }
-    }
+void WebServer::DispatchTask(SubReactor& reactor, int sockfd,
+                             TaskEvent event) {
+  ConnectionSlot& slot = slots_[sockfd];
+  HttpConnection* http = &slot.conn->http;
+  bool queued = false;
+  if (event == TaskEvent::kProcess) {
+    queued = thread_pool_->AppendProactor(http);
   } else {
-    // Proactor 模型
-    if (users_[sockfd].read_once()) {
-      LOG_INFO("deal with the client(%s)",
-               inet_ntoa(users_[sockfd].get_address()->sin_addr));
+    queued = thread_pool_->Append(http, event == TaskEvent::kRead ? 0 : 1);
+  }
+  if (queued) {
+    ++slot.client.pending_tasks;
+    return;
+  }
+  // 工作队列已满。fd 的 EPOLLONESHOT 事件已被消费，不关闭就只能等空闲超时
+  LOG_WARN("work queue full, closing fd %d", sockfd);
+  HandleTimer(reactor, sockfd);
+}
 
-      // 将读事件添加到请求队列
-      thread_pool_->AppendProactor(std::shared_ptr<HttpConnection>(&users_[sockfd], [](HttpConnection*){}));
+void WebServer::HandleRead(SubReactor& reactor, int sockfd) {
+  HttpConnection* http = &slots_[sockfd].conn->http;
 
-      if (timer) {
-        AdjustTimer(timer);
-      }
+  // Reactor 模型：读取与处理都交给工作线程，结果经完成队列异步返回
+  if (actor_model_ == 1) {
+    DispatchTask(reactor, sockfd, TaskEvent::kRead);
+  } else {
+    // Proactor 模型
+    if (http->read_once()) {
+      // 将读事件添加到请求队列，定时器在完成通知返回时调整
+      DispatchTask(reactor, sockfd, TaskEvent::kProcess);
     } else {
-      HandleTimer(timer, sockfd);
+      HandleTimer(reactor, sockfd);
     }
   }
 }
 
-void WebServer::HandleWrite(int sockfd) {
-  Timer* timer = users_timer_[sockfd].timer;
+void WebServer::HandleWrite(SubReactor& reactor, int sockfd) {
+  ConnectionSlot& slot = slots_[sockfd];
+  HttpConnection* http = &slot.conn->http;
 
-  // Reactor 模型
+  // Reactor 模型：写入交给工作线程，结果经完成队列异步返回
   if (actor_model_ == 1) {
-    if (timer) {
-      AdjustTimer(timer);
-    }
-
-    thread_pool_->Append(std::shared_ptr<HttpConnection>(&users_[sockfd], [](HttpConnection*){}), 1);
-
-    while (true) {
-      if (users_[sockfd].improv == 1) {
-        if (users_[sockfd].timer_flag == 1) {
-          HandleTimer(timer, sockfd);
-          users_[sockfd].timer_flag = 0;
-        }
-        users_[sockfd].improv = 0;
-        break;
-      }
-    }
+    DispatchTask(reactor, sockfd, TaskEvent::kWrite);
   } else {
     // Proactor 模型
-    if (users_[sockfd].write()) {
-      LOG_INFO("send data to the client(%s)",
-               inet_ntoa(users_[sockfd].get_address()->sin_addr));
-
-      if (timer) {
-        AdjustTimer(timer);
+    if (http->write()) {
+      // 读缓冲区中还有完整的流水线请求，直接交给工作线程处理
+      if (http->HasBufferedRequest()) {
+        DispatchTask(reactor, sockfd, TaskEvent::kProcess);
+      } else if (slot.client.timer) {
+        AdjustTimer(reactor, slot.client.timer);
       }
     } else {
-      HandleTimer(timer, sockfd);
+      HandleTimer(reactor, sockfd);
     }
   }
 }
 
 void WebServer::EventLoop() {
-  bool timeout = false;
+  // 子反应堆 1..N-1 运行在独立线程上，主反应堆运行在调用线程上
+  for (size_t i = 1; i < reactors_.size(); ++i) {
+    SubReactor* reactor = reactors_[i].get();
+    reactor->thread = std::thread([this, reactor]() { RunReactor(*reactor); });
+  }
+
+  RunReactor(*reactors_.front());
+
+  for (size_t i = 1; i < reactors_.size(); ++i) {
+    if (reactors_[i]->thread.joinable()) {
+      reactors_[i]->thread.join();
+    }
+  }
+}
+
+void WebServer::RunReactor(SubReactor& reactor) {
   bool stop_server = false;
+  const bool is_main = reactor.id == 0;
 
-  while (!stop_server) {
-    int number = epoll_wait(epoll_fd_, events_, kMaxEventNumber, -1);
+  // 定时器由 timerfd 唤醒，信号由 signalfd 唤醒，因此 epoll_wait 可以无限期阻塞
+  while (!stop_server && !stop_server_.load(std::memory_order_acquire)) {
+    int number = epoll_wait(reactor.epoll_fd, reactor.events.data(),
+                            kMaxEventNumber, -1);
     if (number < 0 && errno != EINTR) {
       LOG_ERROR("%s", "epoll failure");
       break;
     }
+    ++reactor.batch;
 
     for (int i = 0; i < number; i++) {
-      int sockfd = events_[i].data.fd;
+      const epoll_event& event = reactor.events[static_cast<size_t>(i)];
+      int sockfd = event.data.fd;
 
       // 处理新的客户端连接
-      if (sockfd == listen_fd_) {
-        bool flag = HandleClientData();
+      if (sockfd == reactor.listen_fd) {
+        bool flag = HandleClientData(reactor);
         if (flag == false) {
           continue;
         }
-      } else if (events_[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-        // 服务器关闭连接，移除定时器
-        Timer* timer = users_timer_[sockfd].timer;
-        HandleTimer(timer, sockfd);
-      }
-      // 处理信号
-      else if ((sockfd == pipe_fd_[0]) && (events_[i].events & EPOLLIN)) {
-        bool flag = HandleSignal(timeout, stop_server);
+      } else if (sockfd == stop_fd_) {
+        // 其他反应堆已收到 SIGTERM
+        stop_server = true;
+      } else if (sockfd == reactor.completions->fd()) {
+        // 工作线程回传的处理结果
+        HandleCompletions(reactor);
+      } else if (sockfd == reactor.timer_utils.timer_fd()) {
+        // 最近的连接定时器到期
+        reactor.timer_utils.HandleTimer();
+        LOG_DEBUG("%s", "timer tick");
+      } else if (is_main && sockfd == signal_fd_) {
+        // 处理信号
+        bool flag = HandleSignal(stop_server);
         if (flag == false) {
-          LOG_ERROR("%s", "dealclientdata failure");
+          LOG_ERROR("%s", "dealsignal failure");
         }
+      } else if (slots_[sockfd].conn == nullptr ||
+                 slots_[sockfd].client.epollfd != reactor.epoll_fd ||
+                 slots_[sockfd].accepted_batch == reactor.batch) {
+        // 连接已在本批事件中关闭，事件已过期；fd 可能已被其他子反应堆复用，
+        // 也可能已被本批中的 accept 复用，新连接不会出现在接受它的那一批事件里
+        continue;
+      } else if (event.events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        // 服务器关闭连接，移除定时器
+        HandleTimer(reactor, sockfd);
       }
       // 处理客户端数据
-      else if (events_[i].events & EPOLLIN) {
-        HandleRead(sockfd);
-      } else if (events_[i].events & EPOLLOUT) {
-        HandleWrite(sockfd);
+      else if (event.events & EPOLLIN) {
+        HandleRead(reactor, sockfd);
+      } else if (event.events & EPOLLOUT) {
+        HandleWrite(reactor, sockfd);
       }
     }
 
-    if (timeout) {
-      timer_utils_.HandleTimer();
-      LOG_INFO("%s", "timer tick");
-      timeout = false;
+    // 空闲池超出上限的连接对象在一批事件处理完后再释放
+    if (reactor.idle_connections.size() > kMaxIdleConnections) {
+      reactor.idle_connections.resize(kMaxIdleConnections);
     }
   }
+
+  // 主反应堆收到 SIGTERM 后唤醒其余子反应堆
+  if (stop_server && !stop_server_.exchange(true)) {
+    uint64_t one = 1;
+    ssize_t n = ::write(stop_fd_, &one, sizeof(one));
+    (void)n;
+  }
 }
 
 }  // namespace tinywebserver
-
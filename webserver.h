@@ -11,9 +11,15 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "./CGImysql/sql_connection_pool.h"
@@ -29,6 +35,54 @@ constexpr int kMaxFd = 65536;           // Maximum file descriptors
 constexpr int kMaxEventNumber = 10000;  // Maximum epoll events
 constexpr int kTimeSlot = 5;            // Minimum timeout unit (seconds)
 
+constexpr size_t kMaxIdleConnections = 256;  // Pooled per sub-reactor
+
+// State of an accepted connection that is only touched while a request is
+// read, processed or written. Allocated on accept and recycled on close.
+struct Connection {
+  HttpConnection http;
+  Timer timer;  // Idle timeout; its callback closes the connection
+  // Neighbours in the owning sub-reactor's list of open connections
+  Connection* live_prev{nullptr};
+  Connection* live_next{nullptr};
+};
+
+// Per-fd entry of the connection table, read on every event of the fd.
+// Padded to a cache line so reactors working on neighbouring fds never
+// share one. conn is null while the fd is not an open connection.
+// The table is zero-filled anonymous memory that is never constructed
+// slot by slot, so an all-zero slot must be a valid idle slot.
+struct alignas(64) ConnectionSlot {
+  ClientData client;
+  Connection* conn;
+  // SubReactor::batch of the owning reactor when the fd was accepted
+  uint64_t accepted_batch;
+};
+static_assert(std::is_trivially_default_constructible_v<ConnectionSlot>,
+              "ConnectionSlot must be valid as zero-filled memory");
+
+// Per-thread event loop state for the multi-reactor mode.
+// Each sub-reactor owns its epoll instance, its own SO_REUSEPORT listen
+// socket and the timers of the connections it accepted. The kernel balances
+// new connections across the listen sockets, so a connection never leaves
+// the reactor that accepted it. The fd-indexed connection table is shared,
+// but a slot is only touched by the reactor owning that fd.
+struct SubReactor {
+  int id{0};
+  int epoll_fd{-1};
+  int listen_fd{-1};
+  std::vector<epoll_event> events;
+  uint64_t batch{0};  // Number of epoll_wait batches handled so far
+  std::unique_ptr<CompletionQueue> completions;  // Worker -> loop results
+  TimerUtils timer_utils;                        // Timer wheel + timerfd
+  // Closed connections ready for reuse. Trimmed to kMaxIdleConnections
+  // after each batch of events, never from inside a timer callback.
+  std::vector<std::unique_ptr<Connection>> idle_connections;
+  // Open connections accepted by this reactor, freed at shutdown
+  Connection* live_connections{nullptr};
+  std::thread thread;
+};
+
 // Main web server class managing connections, events, and request processing.
 class WebServer {
  public:
@@ -53,10 +107,13 @@ class WebServer {
   // @param thread_num Thread pool size
   // @param close_log Log disable flag
   // @param actor_model Concurrency model (0=Proactor, 1=Reactor)
+  // @param reactor_num Number of sub-reactors (event loop threads)
+  // @param work_stealing Thread pool scheduler (0=locked queue, 1=work stealing)
   void Init(int port, const std::string& user, const std::string& password,
             const std::string& database_name, int log_write_mode,
             int opt_linger, int trigger_mode, int sql_num, int thread_num,
-            int close_log, int actor_model);
+            int close_log, int actor_model, int reactor_num = 1,
+            int work_stealing = 0);
 
   // Initializes thread pool
   void InitThreadPool();
@@ -64,49 +121,112 @@ class WebServer {
   // Initializes database connection pool
   void InitSqlPool();
 
+  // Loads the in-memory user table used by login and registration and
+  // keeps it in sync with MySQL. Call after InitSqlPool.
+  // @param refresh_s Reload interval in seconds, 0 loads only once
+  void InitUserStore(int refresh_s);
+
   // Initializes logging system
-  void InitLog();
+  // @param level Minimum runtime log level (0=debug, 1=info, 2=warn, 3=error)
+  // @param binary Log file format (0=text, 1=binary .tlog for tinylog-decode)
+  void InitLog(int level, int binary = 0);
+
+  // Opens the per-request access log (./AccessLog).
+  // @param format 0=off, 1=combined, 2=JSON lines
+  // @param sample_rate Records one request in every sample_rate
+  void InitAccessLog(int format, int sample_rate);
+
+  // Initializes the shared static file cache.
+  // @param memory_mb Memory budget of cached mappings in MB (0=disabled)
+  // @param max_entry_kb Largest cached file in KB
+  // @param revalidate_ms Interval between mtime checks of a cached file
+  // @param sendfile_threshold_kb Files this large are sent with sendfile
+  void InitFileCache(int memory_mb, int max_entry_kb, int revalidate_ms,
+                     int sendfile_threshold_kb);
+
+  // Sets the Cache-Control rules for static files.
+  // @param rules (URL prefix, directives) pairs
+  void InitCacheControl(
+      const std::vector<std::pair<std::string, std::string>>& rules);
+
+  // Sets how text files are compressed.
+  // @param mode 0=off, 1=precompressed siblings, 2=also in-memory variants
+  void InitCompression(int mode);
+
+  // Loads extra MIME types on top of the built-in table.
+  // @param file Types file path, ignored if empty
+  void InitMimeTypes(const std::string& file);
 
   // Sets trigger mode for listen and connection sockets
   void SetTriggerMode();
 
-  // Starts listening for connections
+  // Creates one listen socket and epoll instance per sub-reactor
   void StartListen();
 
-  // Main event loop for handling connections and events
+  // Runs the sub-reactors: reactor 0 on the calling thread, the others on
+  // their own threads. Returns once SIGTERM has been received.
   void EventLoop();
 
+  // Event loop of a single sub-reactor.
+  // @param reactor Sub-reactor to run
+  void RunReactor(SubReactor& reactor);
+
   // Adds a timer for the specified connection.
+  // @param reactor Sub-reactor that accepted the connection
   // @param connfd Connection file descriptor
   // @param client_address Client socket address
-  void AddTimer(int connfd, const sockaddr_in& client_address);
+  void AddTimer(SubReactor& reactor, int connfd,
+                const sockaddr_in& client_address);
 
   // Adjusts timer expiration time.
+  // @param reactor Sub-reactor owning the timer
   // @param timer Timer to adjust
-  void AdjustTimer(Timer* timer);
+  void AdjustTimer(SubReactor& reactor, Timer* timer);
+
+  // Removes the connection's timer and closes it.
+  // @param reactor Sub-reactor owning the connection
+  // @param sockfd Socket file descriptor
+  void HandleTimer(SubReactor& reactor, int sockfd);
 
-  // Handles timer expiration and closes connection.
-  // @param timer Timer that expired
+  // Closes a connection whose timer is already unlinked. The close waits
+  // while worker tasks are pending; otherwise the connection object goes
+  // back to the reactor's pool.
+  // @param reactor Sub-reactor owning the connection
   // @param sockfd Socket file descriptor
-  void HandleTimer(Timer* timer, int sockfd);
+  void CloseConnection(SubReactor& reactor, int sockfd);
+
+  // Queues a worker task for the connection, closing the connection if the
+  // work queue is full: its EPOLLONESHOT event is already consumed, so it
+  // would otherwise hang until the idle timeout.
+  // @param reactor Sub-reactor owning the connection
+  // @param sockfd Socket file descriptor
+  // @param event Task to queue (kRead/kWrite in reactor mode, kProcess in
+  //        proactor mode)
+  void DispatchTask(SubReactor& reactor, int sockfd, TaskEvent event);
 
   // Handles new client connections.
+  // @param reactor Sub-reactor whose listen socket is readable
   // @return true if successful, false otherwise
-  bool HandleClientData();
+  bool HandleClientData(SubReactor& reactor);
 
-  // Handles signals received via pipe.
-  // @param timeout Output parameter set to true if SIGALRM received
+  // Handles signals received via signalfd.
   // @param stop_server Output parameter set to true if SIGTERM received
   // @return true if successful, false otherwise
-  bool HandleSignal(bool& timeout, bool& stop_server);
+  bool HandleSignal(bool& stop_server);
+
+  // Applies the close/timer-adjust requests posted by worker threads.
+  // @param reactor Sub-reactor whose completion queue is readable
+  void HandleCompletions(SubReactor& reactor);
 
   // Handles read event on socket.
+  // @param reactor Sub-reactor owning the socket
   // @param sockfd Socket file descriptor
-  void HandleRead(int sockfd);
+  void HandleRead(SubReactor& reactor, int sockfd);
 
   // Handles write event on socket.
+  // @param reactor Sub-reactor owning the socket
   // @param sockfd Socket file descriptor
-  void HandleWrite(int sockfd);
+  void HandleWrite(SubReactor& reactor, int sockfd);
 
  private:
   // Basic configuration
@@ -115,11 +235,14 @@ class WebServer {
   int log_write_mode_;
   int close_log_;
   int actor_model_;
+  int reactor_num_;
 
   // File descriptors
-  int pipe_fd_[2];
-  int epoll_fd_;
-  std::vector<HttpConnection> users_;
+  int signal_fd_;  // signalfd for SIGTERM, registered with reactor 0
+  int stop_fd_;  // eventfd that wakes every sub-reactor on shutdown
+  // kMaxFd slots in an anonymous mapping, so the pages of unused fds are
+  // never touched
+  ConnectionSlot* slots_;
 
   // Database connection pool
   ConnectionPool* conn_pool_;
@@ -131,20 +254,17 @@ class WebServer {
   // Thread pool
   std::unique_ptr<ThreadPool<HttpConnection>> thread_pool_;
   int thread_num_;
+  int work_stealing_;
 
-  // Epoll events
-  epoll_event events_[kMaxEventNumber];
+  // Sub-reactors
+  std::vector<std::unique_ptr<SubReactor>> reactors_;
+  std::atomic<bool> stop_server_;
 
-  // Listen socket
-  int listen_fd_;
+  // Listen socket options
   int opt_linger_;
   int trigger_mode_;
   int listen_trigger_mode_;
   int conn_trigger_mode_;
-
-  // Timer management
-  std::vector<ClientData> users_timer_;
-  TimerUtils timer_utils_;
 };
 
 }  // namespace tinywebserver